@@ -0,0 +1,93 @@
+#ifndef ATOMTABLE_H
+#define ATOMTABLE_H
+
+#include <cassert>
+#include <vector>
+#include "Bitset.h"
+
+/**
+   @brief Map from a pair of non-negative ints to an int, in a flat open-addressing table.
+
+   The pair is packed in one 64 bits key and the slots are probed linearly, so a
+   lookup is usually one cache line. The table is kept at most half full.
+ */
+class AtomTable{
+    struct Slot{
+        u64 key;
+        int value;
+    };
+    static constexpr u64 empty = ~u64(0);
+
+    std::vector<Slot> _slots;
+    size_t _size = 0;
+    int _shift = 61; // 64 - log2(capacity)
+
+    static u64 pack(int a, int b){
+        assert(a >= 0 and b >= 0);
+        return (u64(a) << 32) | u64(b);
+    }
+    // first slot to probe for key (Fibonacci hashing).
+    size_t home(u64 key) const {
+        return (key * 0x9E3779B97F4A7C15ULL) >> _shift;
+    }
+    size_t mask() const {
+        return _slots.size() -1;
+    }
+    void grow(){
+        std::vector<Slot> old(_slots.size() * 2, Slot{empty, 0});
+        old.swap(_slots);
+        --_shift;
+        for(const Slot& s : old){
+            if(s.key == empty) continue;
+            size_t i = home(s.key);
+            while(_slots[i].key != empty) i = (i+1) & mask();
+            _slots[i] = s;
+        }
+    }
+
+public:
+    AtomTable() : _slots(8, Slot{empty, 0}){}
+
+    // value of (a, b), -1 if absent.
+    int find(int a, int b) const {
+        u64 key = pack(a, b);
+        for(size_t i = home(key) ; ; i = (i+1) & mask()){
+            if(_slots[i].key == key) return _slots[i].value;
+            if(_slots[i].key == empty) return -1;
+        }
+    }
+
+    // value of (a, b), set to value first if absent.
+    int insert(int a, int b, int value){
+        if(2 * (_size + 1) > _slots.size()) grow();
+        u64 key = pack(a, b);
+        size_t i = home(key);
+        for(; _slots[i].key != empty ; i = (i+1) & mask()){
+            if(_slots[i].key == key) return _slots[i].value;
+        }
+        _slots[i] = Slot{key, value};
+        ++_size;
+        return value;
+    }
+
+    // set the value of (a, b), inserting it if absent.
+    void set(int a, int b, int value){
+        if(2 * (_size + 1) > _slots.size()) grow();
+        u64 key = pack(a, b);
+        size_t i = home(key);
+        for(; _slots[i].key != empty ; i = (i+1) & mask()){
+            if(_slots[i].key == key){
+                _slots[i].value = value;
+                return;
+            }
+        }
+        _slots[i] = Slot{key, value};
+        ++_size;
+    }
+
+    size_t size() const {
+        return _size;
+    }
+};
+
+#endif
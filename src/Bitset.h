@@ -5,6 +5,7 @@
 #include <cstddef>
 #include <ostream>
 #include <cstring>
+#include <algorithm>
 
 using u64 = unsigned long long;
 using u8 = unsigned char;
@@ -44,12 +45,13 @@ public:
 class Bitset{
     u64* _data;
     size_t _size;
+    size_t _words; // number of allocated words
 public:
     /// Create empty bitset, all other operation are UB until @ref init.
-    Bitset() : _data(nullptr), _size(0) {}
+    Bitset() : _data(nullptr), _size(0), _words(0) {}
 
     /// Create bitset manipulating data with size (in bits) size.
-    explicit Bitset(size_t size) : _data(new u64[(size+63)/64]), _size(size){}
+    explicit Bitset(size_t size) : _data(new u64[(size+63)/64]), _size(size), _words((size+63)/64){}
 
     ~Bitset(){
         if(_data) delete[] _data;
@@ -205,6 +207,31 @@ public:
         return _size;
     }
 
+    /**
+       @brief Change the size of the bitset, the new bits are set to value.
+
+       The storage at least doubles when it grows, so a sequence of resizes by
+       one bit costs amortized constant time.
+     */
+    void resize(size_t size, bool value = false){
+        size_t words = (size+63)/64;
+        if(words > _words){
+            size_t nwords = std::max(words, 2*_words);
+            u64* data = new u64[nwords];
+            if(_data){
+                memcpy(data, _data, _words * sizeof(u64));
+                delete[] _data;
+            }
+            _data = data;
+            _words = nwords;
+        }
+        size_t old = _size;
+        _size = size;
+        for(size_t i = old ; i < size ; ++i){
+            (*this)[i] = value;
+        }
+    }
+
     /// Clear the bitset to 0.
     void clear(){
         memset(_data,0,(_size+7)/8);
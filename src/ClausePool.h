@@ -0,0 +1,113 @@
+#ifndef CLAUSEPOOL_H
+#define CLAUSEPOOL_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+// Contiguous range of T that is not owned, like the C++20 std::span.
+template<typename T>
+class Span{
+    T* _begin = nullptr;
+    T* _end = nullptr;
+public:
+    Span(){}
+    Span(T* begin, T* end) : _begin(begin), _end(end){}
+    T* begin() const {return _begin;}
+    T* end() const {return _end;}
+    T* data() const {return _begin;}
+    size_t size() const {return _end - _begin;}
+    bool empty() const {return _begin == _end;}
+    T& operator[](size_t i) const {return _begin[i];}
+    T& front() const {return *_begin;}
+    T& back() const {return _end[-1];}
+};
+
+/**
+   @brief Clauses of a formula stored in compressed rows : the literals of all
+   the clauses in one array, and the start of each clause in this array.
+
+   A clause is accessed as a View, built from the Span of its literals (see
+   SatCnf::ClauseRef) : views are invalidated when a clause is added. Adding
+   a clause only appends to the two arrays, so reading a formula of n clauses
+   makes O(log n) allocations instead of one per clause.
+ */
+template<typename Lit, typename View>
+class ClausePool{
+    std::vector<Lit> _lits;
+    // clause i is [_start[i], _start[i+1]) in _lits.
+    std::vector<size_t> _start = std::vector<size_t>(1, 0);
+
+public:
+    class const_iterator{
+        const ClausePool* _pool;
+        size_t _i;
+    public:
+        const_iterator(const ClausePool* pool, size_t i) : _pool(pool), _i(i){}
+        View operator*() const {return (*_pool)[_i];}
+        const_iterator& operator++(){
+            ++_i;
+            return *this;
+        }
+        bool operator==(const const_iterator& o) const {return _i == o._i;}
+        bool operator!=(const const_iterator& o) const {return _i != o._i;}
+    };
+
+    size_t size() const {return _start.size() -1;}
+    bool empty() const {return size() == 0;}
+    // Total number of literals.
+    size_t numLiterals() const {return _lits.size();}
+    View operator[](size_t i) const {
+        assert(i < size());
+        return View(Span<const Lit>(_lits.data() + _start[i], _lits.data() + _start[i+1]));
+    }
+    View front() const {return (*this)[0];}
+    View back() const {return (*this)[size() -1];}
+    const_iterator begin() const {return const_iterator(this, 0);}
+    const_iterator end() const {return const_iterator(this, size());}
+
+    void reserve(size_t numClauses, size_t numLiterals = 0){
+        _start.reserve(numClauses +1);
+        _lits.reserve(numLiterals);
+    }
+    void clear(){
+        _lits.clear();
+        _start.resize(1);
+    }
+
+    // Add a copy of cl, which must not be a clause of this pool.
+    void push_back(View cl){
+        _lits.insert(_lits.end(), cl.literals.begin(), cl.literals.end());
+        _start.push_back(_lits.size());
+    }
+    // Add a clause literal by literal : the literals pushed since the last
+    // clause are a new clause when closeClause is called.
+    void pushLiteral(const Lit& lit){
+        _lits.push_back(lit);
+    }
+    void closeClause(){
+        _start.push_back(_lits.size());
+    }
+    // Add clauses of the given sizes at once : all their literals, in order, are to
+    // be written in the returned span before any other change.
+    template<typename Sizes>
+    Span<Lit> addClauses(const Sizes& sizes){
+        size_t first = _lits.size();
+        size_t end = first;
+        for(auto size : sizes){
+            end += size;
+            _start.push_back(end);
+        }
+        _lits.resize(end);
+        return Span<Lit>(_lits.data() + first, _lits.data() + end);
+    }
+    // Add a clause of n literals, to be written in the returned span before any
+    // other change.
+    Span<Lit> addClause(size_t n){
+        _lits.resize(_lits.size() + n);
+        _start.push_back(_lits.size());
+        return Span<Lit>(_lits.data() + _lits.size() - n, _lits.data() + _lits.size());
+    }
+};
+
+#endif
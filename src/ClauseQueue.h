@@ -0,0 +1,117 @@
+#ifndef CLAUSEQUEUE_H
+#define CLAUSEQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "SatCnf.h"
+
+/**
+   @brief Lock-free queue of clauses from any number of producer threads to one
+   consumer (a SatSolver, see SatSolver::setQueue).
+
+   A producer copies its clause in a node and pushes it on a stack with a
+   compare-and-swap. The consumer takes the whole stack with one exchange and
+   reverses it, so the clauses are taken in the order of their push, in batches.
+   The consumer only looks at the stack between two steps of its own work, and
+   when it has nothing else to do it sleeps in wait() : a push or a close() wakes
+   it. A push only takes the lock when the consumer is waiting.
+
+   close() signals the end of the input, after the last push of every producer.
+ */
+class ClauseQueue{
+    struct Node{
+        SatCnf::Clause clause;
+        Node* next;
+    };
+    std::atomic<Node*> _head{nullptr};
+    std::atomic<bool> _closed{false};
+    // set by the consumer while it waits.
+    std::atomic<bool> _waiting{false};
+    std::mutex _mutex;
+    std::condition_variable _wake;
+
+    void notify(){
+        // under the lock, the consumer is either before its last check or asleep.
+        { std::lock_guard<std::mutex> lock(_mutex); }
+        _wake.notify_one();
+    }
+
+public:
+    ClauseQueue(){}
+    ClauseQueue(const ClauseQueue&) = delete;
+    ClauseQueue& operator=(const ClauseQueue&) = delete;
+    ~ClauseQueue(){
+        Node* n = _head.load();
+        while(n){
+            Node* next = n->next;
+            delete n;
+            n = next;
+        }
+    }
+
+    // Add a copy of cl. Any thread.
+    void push(SatCnf::ClauseRef cl){
+        Node* n = new Node{SatCnf::Clause{std::vector<SatCnf::Literal>(cl.literals.begin(), cl.literals.end())}, nullptr};
+        n->next = _head.load(std::memory_order_relaxed);
+        while(!_head.compare_exchange_weak(n->next, n, std::memory_order_seq_cst, std::memory_order_relaxed)){}
+        if(_waiting.load()) notify();
+    }
+    // No clause will be pushed anymore.
+    void close(){
+        _closed.store(true);
+        notify();
+    }
+
+    // The consumer : true if there is a clause to take.
+    bool pending() const {
+        return _head.load(std::memory_order_relaxed) != nullptr;
+    }
+    // The consumer : true after close(). If it is read before a call of take(),
+    // this call takes all the remaining clauses.
+    bool closed() const {
+        return _closed.load(std::memory_order_acquire);
+    }
+    // The consumer : sleep until a clause is pending, the queue is closed or
+    // *interrupt (if not null) is true. interrupt is checked every millisecond,
+    // since the threads that set it don't wake the consumer.
+    void wait(const std::atomic<bool>* interrupt = nullptr){
+        std::unique_lock<std::mutex> lock(_mutex);
+        _waiting.store(true);
+        auto ready = [&]{
+            // seq_cst, as the push : either the push sees _waiting or this sees the push.
+            return _head.load() != nullptr or closed() or (interrupt and *interrupt);
+        };
+        while(!ready()){
+            if(interrupt) _wake.wait_for(lock, std::chrono::milliseconds(1));
+            else _wake.wait(lock);
+        }
+        _waiting.store(false);
+    }
+    // The consumer : give the clauses pushed since the last call to out, in
+    // order, and return their number.
+    template<typename Out>
+    size_t take(Out&& out){
+        Node* n = _head.exchange(nullptr, std::memory_order_acquire);
+        Node* first = nullptr;
+        while(n){
+            Node* next = n->next;
+            n->next = first;
+            first = n;
+            n = next;
+        }
+        size_t count = 0;
+        while(first){
+            Node* next = first->next;
+            out(SatCnf::ClauseRef(first->clause));
+            delete first;
+            first = next;
+            ++count;
+        }
+        return count;
+    }
+};
+
+#endif
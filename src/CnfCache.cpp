@@ -0,0 +1,215 @@
+#include "CnfCache.h"
+#include <cerrno>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <ios>
+#include <vector>
+#include "InputBuffer.h"
+
+using namespace std;
+
+namespace {
+const uint32_t version = 1;
+
+struct Header{
+    char magic[4];
+    uint32_t version;
+    uint64_t numVar;
+    uint64_t numClauses;
+    uint64_t numLiterals;
+    uint64_t numApps;
+    uint64_t numArgs;
+};
+
+const char satMagic[4] = {cacheFirstByte, 'S', 'A', 'T'};
+const char smtMagic[4] = {cacheFirstByte, 'S', 'M', 'T'};
+
+// The error is in the data, not in a system call : errno would hide the message.
+[[noreturn]] void fail(const string& msg){
+    errno = 0;
+    throw ios_base::failure("Invalid cache : " + msg);
+}
+
+void write(ostream& out, const void* data, size_t bytes){
+    out.write(static_cast<const char*>(data), bytes);
+    if(!out) throw ios_base::failure("Can't write the cache");
+}
+
+void writeWords(ostream& out, const vector<uint32_t>& words){
+    write(out, words.data(), words.size() * sizeof(uint32_t));
+}
+
+void read(InputBuffer& in, void* data, size_t bytes){
+    if(in.read(static_cast<char*>(data), bytes) != bytes) fail("truncated");
+}
+
+void readWords(InputBuffer& in, vector<uint32_t>& words, size_t n){
+    words.resize(n);
+    read(in, words.data(), n * sizeof(uint32_t));
+}
+
+Header readHeader(InputBuffer& in, const char* magic){
+    Header h;
+    read(in, &h, sizeof(h));
+    if(memcmp(h.magic, satMagic, 4) != 0 and memcmp(h.magic, smtMagic, 4) != 0) fail("bad magic");
+    if(memcmp(h.magic, magic, 4) != 0) fail("wrong kind of formula");
+    if(h.version != version) fail("unknown version or byte order");
+    if(h.numVar > 0x7fffffff) fail("too many variables");
+    return h;
+}
+
+// Give the n records of bytes bytes at the position of in to out(p, k), k records
+// from p at a time, where they are : the whole array at once from a mapped file,
+// a block at a time otherwise. Only a record that crosses the end of a block is
+// copied.
+template<typename Out>
+void scanRecords(InputBuffer& in, uint64_t n, size_t bytes, Out out){
+    char record[16];
+    while(n > 0){
+        const char* p = in.chunk();
+        size_t k = min<uint64_t>(n, in.available() / bytes);
+        if(k == 0){
+            read(in, record, bytes);
+            out(record, 1);
+            --n;
+            continue;
+        }
+        out(p, k);
+        in.skip(k * bytes);
+        n -= k;
+    }
+}
+
+// Word i from p, which may not be aligned.
+inline uint32_t word(const char* p, size_t i){
+    uint32_t w;
+    memcpy(&w, p + 4*i, 4);
+    return w;
+}
+
+// Read the clause sizes and check that they add up to the number of literals.
+void readSizes(InputBuffer& in, const Header& h, vector<uint32_t>& sizes){
+    readWords(in, sizes, h.numClauses);
+    uint64_t total = 0;
+    for(uint32_t s : sizes) total += s;
+    if(total != h.numLiterals) fail("clause sizes don't match the number of literals");
+}
+}
+
+void writeCache(const SatCnf& sc, ostream& out){
+    Header h = {{}, version, sc._numVar, sc.clauses.size(), 0, 0, 0};
+    memcpy(h.magic, satMagic, 4);
+    vector<uint32_t> sizes;
+    sizes.reserve(sc.clauses.size());
+    for(const auto& cl : sc.clauses){
+        sizes.push_back(cl.literals.size());
+        h.numLiterals += cl.literals.size();
+    }
+    write(out, &h, sizeof(h));
+    writeWords(out, sizes);
+    vector<uint32_t> lits;
+    for(const auto& cl : sc.clauses){
+        lits.clear();
+        for(const auto& lit : cl.literals) lits.push_back(2*lit.var + lit.neg);
+        writeWords(out, lits);
+    }
+}
+
+void writeCache(const SmtCnf& sc, ostream& out){
+    Header h = {{}, version, uint64_t(sc._numVar), sc.clauses.size(), 0, sc.apps.size(), 0};
+    memcpy(h.magic, smtMagic, 4);
+    vector<uint32_t> sizes;
+    sizes.reserve(sc.clauses.size());
+    for(const auto& cl : sc.clauses){
+        sizes.push_back(cl.literals.size());
+        h.numLiterals += cl.literals.size();
+    }
+    for(const auto& app : sc.apps) h.numArgs += app.args.size();
+    write(out, &h, sizeof(h));
+    writeWords(out, sizes);
+    vector<uint32_t> words;
+    for(const auto& cl : sc.clauses){
+        words.clear();
+        for(const auto& lit : cl.literals){
+            words.push_back(2*lit.var1 + (lit.type == SmtCnf::Literal::NOTEQ));
+            words.push_back(lit.var2);
+        }
+        writeWords(out, words);
+    }
+    words.clear();
+    for(const auto& app : sc.apps){
+        words.push_back(app.fun);
+        words.push_back(app.term);
+        words.push_back(app.args.size());
+    }
+    writeWords(out, words);
+    for(const auto& app : sc.apps){
+        words.assign(app.args.begin(), app.args.end());
+        writeWords(out, words);
+    }
+}
+
+void readCache(InputBuffer& in, SatCnf& sc){
+    Header h = readHeader(in, satMagic);
+    if(h.numApps != 0 or h.numArgs != 0) fail("applications in a SAT formula");
+    vector<uint32_t> sizes;
+    readSizes(in, h, sizes);
+    sc._numVar = h.numVar;
+    sc.clauses.clear();
+    sc.clauses.reserve(h.numClauses, h.numLiterals);
+    // the literals are checked at once at the end : no branch per literal.
+    SatCnf::Literal* lit = sc.clauses.addClauses(sizes).data();
+    uint32_t maxWord = 0;
+    scanRecords(in, h.numLiterals, 4, [&](const char* p, size_t k){
+            for(size_t i = 0 ; i < k ; ++i){
+                uint32_t w = word(p, i);
+                maxWord = max(maxWord, w);
+                lit[i] = SatCnf::Literal{bool(w & 1), int(w >> 1)};
+            }
+            lit += k;
+        });
+    if(h.numLiterals > 0 and (maxWord >> 1) >= h.numVar) fail("variable out of range");
+}
+
+void readCache(InputBuffer& in, SmtCnf& sc){
+    Header h = readHeader(in, smtMagic);
+    vector<uint32_t> sizes;
+    readSizes(in, h, sizes);
+    sc._numVar = h.numVar;
+    sc.clauses.clear();
+    sc.clauses.reserve(h.numClauses, h.numLiterals);
+    SmtCnf::Literal* lit = sc.clauses.addClauses(sizes).data();
+    uint32_t maxVar = 0;
+    scanRecords(in, h.numLiterals, 8, [&](const char* p, size_t k){
+            for(size_t i = 0 ; i < k ; ++i){
+                uint32_t w1 = word(p, 2*i), w2 = word(p, 2*i+1);
+                maxVar = max(maxVar, max(w1 >> 1, w2));
+                auto type = w1 & 1 ? SmtCnf::Literal::NOTEQ : SmtCnf::Literal::EQUAL;
+                lit[i] = SmtCnf::Literal{type, int(w1 >> 1), int(w2)};
+            }
+            lit += k;
+        });
+    if(h.numLiterals > 0 and maxVar >= h.numVar) fail("variable out of range");
+    vector<uint32_t> words;
+    readWords(in, words, 3*h.numApps);
+    uint64_t total = 0;
+    for(size_t i = 0 ; i < h.numApps ; ++i){
+        if(words[3*i+1] >= h.numVar) fail("application term out of range");
+        total += words[3*i+2];
+    }
+    if(total != h.numArgs) fail("application sizes don't match the number of arguments");
+    sc.apps.resize(h.numApps);
+    for(size_t i = 0 ; i < h.numApps ; ++i){
+        sc.apps[i].fun = words[3*i];
+        sc.apps[i].term = words[3*i+1];
+        sc.apps[i].args.resize(words[3*i+2]);
+    }
+    for(auto& app : sc.apps){
+        readWords(in, words, app.args.size());
+        for(size_t j = 0 ; j < words.size() ; ++j){
+            if(words[j] >= h.numVar) fail("argument out of range");
+            app.args[j] = words[j];
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef CNFCACHE_H
+#define CNFCACHE_H
+
+#include <ostream>
+#include "SatCnf.h"
+#include "SmtCnf.h"
+
+class InputBuffer;
+
+/**
+   @brief Binary cache of a SatCnf or a SmtCnf, to reload a formula without
+   parsing its text.
+
+   The file is a header followed by arrays of 32 bits words, in the byte order
+   of the machine :
+   - the header : 4 bytes of magic ("\x93SAT" or "\x93SMT"), the version,
+     then 64 bits counts : variables, clauses, literals, applications and
+     arguments of the applications (0 for a SAT formula);
+   - the size of each clause;
+   - the literals of all the clauses : 2*var + neg for SAT, 2*var1 + (type ==
+     NOTEQ) then var2 for SMT;
+   - for SMT, fun, term and number of arguments of each application, then
+     the arguments of all the applications.
+
+   The cache is read through an InputBuffer : the literals of a mapped file are
+   converted from the map straight into the ClausePool of the formula, in one
+   pass checked once at the end, and a compressed cache is decompressed on the fly
+   and converted block by block.
+   The first byte can't start a text formula, so the parsers of SatCnf and
+   SmtCnf recognize a cache by it.
+ */
+const char cacheFirstByte = '\x93';
+
+// Write the cache of a formula. Throws std::ios_base::failure if out fails.
+void writeCache(const SatCnf& sc, std::ostream& out);
+void writeCache(const SmtCnf& sc, std::ostream& out);
+
+// Read a cache into sc, which must be empty. Throws std::ios_base::failure if
+// the input is not a valid cache of this kind of formula.
+void readCache(InputBuffer& in, SatCnf& sc);
+void readCache(InputBuffer& in, SmtCnf& sc);
+
+#endif
@@ -0,0 +1,171 @@
+#include "Decompose.h"
+#include <atomic>
+#include <numeric>
+#include "SatSolver.h"
+#include "SmallSolver.h"
+#include "Parallel.h"
+
+using namespace std;
+
+namespace {
+// Plain union-find to compute the components.
+struct UnionFind{
+    vector<int> parent;
+    explicit UnionFind(size_t n) : parent(n){
+        iota(parent.begin(), parent.end(), 0);
+    }
+    int find(int i){
+        while(parent[i] != i){
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+    void merge(int a, int b){
+        a = find(a);
+        b = find(b);
+        if(a < b) parent[b] = a;
+        else parent[a] = b;
+    }
+};
+
+// Number the components of uf (restricted to used variables) in order of
+// their smallest variable, fill local with the local index of each variable
+// and create the components.
+template<typename Cnf>
+vector<Component<Cnf>> makeComponents(UnionFind& uf, const vector<bool>& used,
+                                      vector<int>& compOf, vector<int>& local){
+    vector<Component<Cnf>> res;
+    size_t n = used.size();
+    compOf.assign(n, -1);
+    local.assign(n, -1);
+    vector<int> rootComp(n, -1);
+    for(size_t i = 0 ; i < n ; ++i){
+        if(!used[i]) continue;
+        int r = uf.find(i);
+        if(rootComp[r] == -1){
+            rootComp[r] = res.size();
+            res.push_back(Component<Cnf>(0));
+        }
+        compOf[i] = rootComp[r];
+        local[i] = res[compOf[i]].vars.size();
+        res[compOf[i]].vars.push_back(i);
+    }
+    for(auto& comp : res){
+        comp.cnf._numVar = comp.vars.size();
+    }
+    return res;
+}
+}
+
+vector<Component<SatCnf>> decompose(const SatCnf& sc, bool& unsat){
+    unsat = false;
+    UnionFind uf(sc._numVar);
+    vector<bool> used(sc._numVar, false);
+    for(const auto& cl : sc.clauses){
+        if(cl.literals.empty()){
+            unsat = true;
+            return {};
+        }
+        for(const auto& lit : cl.literals){
+            used[lit.var] = true;
+            uf.merge(cl.literals.front().var, lit.var);
+        }
+    }
+    vector<int> compOf, local;
+    auto res = makeComponents<SatCnf>(uf, used, compOf, local);
+
+    for(const auto& cl : sc.clauses){
+        auto& lcls = res[compOf[cl.literals.front().var]].cnf.clauses;
+        for(const auto& lit : cl.literals){
+            lcls.pushLiteral(SatCnf::Literal{lit.neg, local[lit.var]});
+        }
+        lcls.closeClause();
+    }
+    return res;
+}
+
+vector<Component<SmtCnf>> decompose(const SmtCnf& sc, bool& unsat){
+    unsat = false;
+    UnionFind uf(sc._numVar);
+    vector<bool> used(sc._numVar, false);
+    for(const auto& cl : sc.clauses){
+        if(cl.literals.empty()){
+            unsat = true;
+            return {};
+        }
+        for(const auto& lit : cl.literals){
+            used[lit.var1] = true;
+            used[lit.var2] = true;
+            uf.merge(cl.literals.front().var1, lit.var1);
+            uf.merge(lit.var1, lit.var2);
+        }
+    }
+    // an application is linked to its arguments by congruence.
+    for(const auto& app : sc.apps){
+        used[app.term] = true;
+        for(int arg : app.args){
+            used[arg] = true;
+            uf.merge(app.term, arg);
+        }
+    }
+    vector<int> compOf, local;
+    auto res = makeComponents<SmtCnf>(uf, used, compOf, local);
+    for(const auto& app : sc.apps){
+        SmtCnf::App lapp{app.fun, {}, local[app.term]};
+        for(int arg : app.args) lapp.args.push_back(local[arg]);
+        res[compOf[app.term]].cnf.apps.push_back(move(lapp));
+    }
+
+    for(const auto& cl : sc.clauses){
+        auto& lcls = res[compOf[cl.literals.front().var1]].cnf.clauses;
+        for(const auto& lit : cl.literals){
+            lcls.pushLiteral(SmtCnf::Literal{lit.type, local[lit.var1], local[lit.var2]});
+        }
+        lcls.closeClause();
+    }
+    return res;
+}
+
+template<typename Solver>
+static vector<bool> solveWith(Solver&& ss, const SatCnf& cnf, const atomic<bool>* stop){
+    ss.setInterrupt(stop);
+    ss.import(cnf);
+    return ss.solve();
+}
+
+vector<bool> solveSat(const SatCnf& sc, bool verbose, bool localSearch){
+    bool empty;
+    auto comps = decompose(sc, empty);
+    if(empty) return {};
+    vector<vector<bool>> sols(comps.size());
+    atomic<bool> unsat(false);
+
+    // verbose output of several solvers can't be interleaved.
+    parallelFor(comps.size(), [&](size_t, size_t i){
+            if(unsat) return;
+            const SatCnf& cnf = comps[i].cnf;
+            if(cnf._numVar <= 64){
+                sols[i] = solveWith(SmallSolver<u64>(cnf._numVar, verbose), cnf, &unsat);
+            }
+            else if(cnf._numVar <= 128){
+                sols[i] = solveWith(SmallSolver<u128>(cnf._numVar, verbose), cnf, &unsat);
+            }
+            else{
+                SatSolver ss(cnf._numVar, verbose);
+                ss.setLocalSearch(localSearch);
+                sols[i] = solveWith(ss, cnf, &unsat);
+            }
+            if(sols[i].empty()) unsat = true;
+        }, verbose ? 1 : 0);
+
+    if(unsat) return {};
+    // unconstrained variables are false.
+    vector<bool> res(sc._numVar, false);
+    for(size_t i = 0 ; i < comps.size() ; ++i){
+        for(size_t j = 0 ; j < comps[i].vars.size() ; ++j){
+            res[comps[i].vars[j]] = sols[i][j];
+        }
+    }
+    return res;
+}
@@ -0,0 +1,33 @@
+#ifndef DECOMPOSE_H
+#define DECOMPOSE_H
+
+#include <vector>
+#include "SatCnf.h"
+#include "SmtCnf.h"
+
+/**
+   @brief A connected component of the variable-clause graph of a formula.
+
+   cnf only uses local variables 0..vars.size()-1 and local variable i is
+   the variable vars[i] of the original formula.
+ */
+template<typename Cnf>
+struct Component{
+    Cnf cnf;
+    std::vector<int> vars;
+    explicit Component(int nVar) : cnf(nVar){}
+};
+
+// Split a formula in independent sub-formulas that share no variable.
+// Variables that appear in no clause (and in no function application) are in no component.
+// An empty clause makes the formula UNSAT : unsat is then set and no component is returned.
+std::vector<Component<SatCnf>> decompose(const SatCnf& sc, bool& unsat);
+std::vector<Component<SmtCnf>> decompose(const SmtCnf& sc, bool& unsat);
+
+// Solve a sat Cnf component by component, in parallel if possible.
+// Components of at most 128 variables are solved by the bit-parallel SmallSolver.
+// If localSearch is set, the solvers are seeded by a local search (see SatSolver::setLocalSearch).
+// Returns empty vector if UNSAT.
+std::vector<bool> solveSat(const SatCnf& sc, bool verbose=false, bool localSearch=false);
+
+#endif
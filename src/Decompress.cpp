@@ -0,0 +1,179 @@
+#include "Decompress.h"
+#include <cerrno>
+#include <cstring>
+#include <ios>
+#include <vector>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+Compression compression(const char* head, size_t n){
+    auto starts = [&](const char* magic, size_t len){
+        return n >= len and memcmp(head, magic, len) == 0;
+    };
+    if(starts("\x1f\x8b", 2)) return Compression::GZIP;
+    if(starts("\xfd" "7zXZ\0", 6)) return Compression::XZ;
+    if(starts("\x28\xb5\x2f\xfd", 4)) return Compression::ZSTD;
+    return Compression::NONE;
+}
+
+namespace {
+// Size of the blocks of compressed bytes.
+const size_t inputSize = 1 << 16;
+
+// The error is in the data, not in a system call : errno would hide the message.
+[[noreturn]] void fail(const string& msg){
+    errno = 0;
+    throw ios_base::failure(msg);
+}
+
+#ifdef HAVE_ZLIB
+class GzipSource : public InputSource{
+    unique_ptr<InputSource> _in;
+    vector<char> _buf;
+    z_stream _z;
+    bool _eof = false;
+    // the end of the current member has not been read.
+    bool _inMember = false;
+public:
+    explicit GzipSource(unique_ptr<InputSource> in) : _in(move(in)), _buf(inputSize){
+        memset(&_z, 0, sizeof(_z));
+        // 16 : gzip header and trailer.
+        if(inflateInit2(&_z, 15 + 16) != Z_OK) fail("Can't initialize zlib");
+    }
+    ~GzipSource(){
+        inflateEnd(&_z);
+    }
+    size_t read(char* buf, size_t n) override {
+        _z.next_out = reinterpret_cast<Bytef*>(buf);
+        _z.avail_out = n;
+        while(_z.avail_out > 0){
+            if(_z.avail_in == 0 and !_eof){
+                size_t r = _in->read(_buf.data(), _buf.size());
+                _eof = r == 0;
+                _z.next_in = reinterpret_cast<Bytef*>(_buf.data());
+                _z.avail_in = r;
+            }
+            if(_z.avail_in == 0 and _eof and !_inMember) break;
+            _inMember = true;
+            int ret = inflate(&_z, Z_NO_FLUSH);
+            if(ret == Z_STREAM_END){
+                _inMember = false;
+                inflateReset(&_z);
+            }
+            // no progress without more input.
+            else if(ret == Z_BUF_ERROR) fail("Truncated gzip input");
+            else if(ret != Z_OK) fail("Corrupted gzip input");
+        }
+        return n - _z.avail_out;
+    }
+};
+#endif
+
+#ifdef HAVE_LZMA
+class XzSource : public InputSource{
+    unique_ptr<InputSource> _in;
+    vector<char> _buf;
+    lzma_stream _s = LZMA_STREAM_INIT;
+    bool _eof = false;
+    bool _done = false;
+public:
+    explicit XzSource(unique_ptr<InputSource> in) : _in(move(in)), _buf(inputSize){
+        if(lzma_stream_decoder(&_s, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK){
+            fail("Can't initialize liblzma");
+        }
+    }
+    ~XzSource(){
+        lzma_end(&_s);
+    }
+    size_t read(char* buf, size_t n) override {
+        _s.next_out = reinterpret_cast<uint8_t*>(buf);
+        _s.avail_out = n;
+        while(_s.avail_out > 0 and !_done){
+            if(_s.avail_in == 0 and !_eof){
+                size_t r = _in->read(_buf.data(), _buf.size());
+                _eof = r == 0;
+                _s.next_in = reinterpret_cast<uint8_t*>(_buf.data());
+                _s.avail_in = r;
+            }
+            lzma_ret ret = lzma_code(&_s, _eof ? LZMA_FINISH : LZMA_RUN);
+            if(ret == LZMA_STREAM_END) _done = true;
+            else if(ret == LZMA_BUF_ERROR) fail("Truncated xz input");
+            else if(ret != LZMA_OK) fail("Corrupted xz input");
+        }
+        return n - _s.avail_out;
+    }
+};
+#endif
+
+#ifdef HAVE_ZSTD
+class ZstdSource : public InputSource{
+    unique_ptr<InputSource> _in;
+    vector<char> _buf;
+    ZSTD_DStream* _ds;
+    ZSTD_inBuffer _inBuf = {nullptr, 0, 0};
+    bool _eof = false;
+public:
+    explicit ZstdSource(unique_ptr<InputSource> in) : _in(move(in)), _buf(inputSize), _ds(ZSTD_createDStream()){
+        if(!_ds) fail("Can't initialize libzstd");
+        ZSTD_initDStream(_ds);
+    }
+    ~ZstdSource(){
+        ZSTD_freeDStream(_ds);
+    }
+    size_t read(char* buf, size_t n) override {
+        ZSTD_outBuffer out = {buf, n, 0};
+        while(out.pos < out.size){
+            if(_inBuf.pos == _inBuf.size and !_eof){
+                size_t r = _in->read(_buf.data(), _buf.size());
+                _eof = r == 0;
+                _inBuf = {_buf.data(), r, 0};
+            }
+            size_t before = out.pos;
+            size_t ret = ZSTD_decompressStream(_ds, &out, &_inBuf);
+            if(ZSTD_isError(ret)) fail("Corrupted zstd input");
+            // at the end of the input, the decoder only flushes what it holds.
+            if(_eof and out.pos == before){
+                if(ret != 0) fail("Truncated zstd input");
+                break;
+            }
+        }
+        return out.pos;
+    }
+};
+#endif
+}
+
+unique_ptr<InputSource> decompress(Compression c, unique_ptr<InputSource> in){
+    switch(c){
+    case Compression::NONE:
+        return in;
+    case Compression::GZIP:
+#ifdef HAVE_ZLIB
+        return unique_ptr<InputSource>(new GzipSource(move(in)));
+#else
+        fail("gzip input, but this build has no zlib");
+#endif
+    case Compression::XZ:
+#ifdef HAVE_LZMA
+        return unique_ptr<InputSource>(new XzSource(move(in)));
+#else
+        fail("xz input, but this build has no liblzma");
+#endif
+    case Compression::ZSTD:
+#ifdef HAVE_ZSTD
+        return unique_ptr<InputSource>(new ZstdSource(move(in)));
+#else
+        fail("zstd input, but this build has no libzstd");
+#endif
+    }
+    return in;
+}
@@ -0,0 +1,28 @@
+#ifndef DECOMPRESS_H
+#define DECOMPRESS_H
+
+#include <memory>
+#include "InputBuffer.h"
+
+/**
+   @brief Streaming decompression of the inputs, detected by their magic number.
+
+   gzip needs zlib, xz needs liblzma and zstd needs libzstd : the Makefile
+   defines HAVE_ZLIB, HAVE_LZMA and HAVE_ZSTD for the ones that are installed.
+   A compressed input is decompressed by blocks into the buffer of the parser,
+   it is never stored whole. Concatenated streams are read one after the other,
+   as gzip -d does.
+ */
+enum class Compression{NONE, GZIP, XZ, ZSTD};
+
+// Number of bytes needed to recognize every format.
+const size_t magicSize = 6;
+
+// Format of an input that starts with the n bytes of head.
+Compression compression(const char* head, size_t n);
+
+// Source of the decompressed bytes of in. Throws std::ios_base::failure if the
+// format is not supported by this build, and when reading a corrupted input.
+std::unique_ptr<InputSource> decompress(Compression c, std::unique_ptr<InputSource> in);
+
+#endif
@@ -0,0 +1,487 @@
+#include "EqTheory.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <map>
+#include "prettyprint.hpp"
+
+using namespace std;
+
+EqTheory::EqTheory(SmtSatKernel& ker, bool verbose, const vector<SmtCnf::App>& apps)
+    : _ker(ker), _verbose(verbose), _parent(ker.numVar), _size(ker.numVar, 1), _next(ker.numVar),
+      _proof(ker.numVar, make_pair(-1, -1)), _mark(ker.numVar, 0), _diseqs(ker.numVar), _assigned(ker.from.size()),
+      _freshAtoms(ker.numVar), _use(ker.numVar), _edgeMark(ker.numVar, 0),
+      _rootMark(ker.numVar, 0), _rootDiseq(ker.numVar, false){
+    for(int i = 0 ; i < ker.numVar ; ++i){
+        _parent[i] = i;
+        _next[i] = i;
+    }
+    for(const auto& app : apps){
+        curry(app);
+    }
+    // the applications with the same arguments are equal from the start.
+    mergePending();
+}
+
+void EqTheory::curry(const SmtCnf::App& app){
+    assert(!app.args.empty());
+    // a function is a vertex for each arity, its partial applications are shared.
+    auto it = _funs.find(make_pair(app.fun, app.args.size()));
+    if(it == _funs.end()) it = _funs.insert(make_pair(make_pair(app.fun, app.args.size()), newVertex())).first;
+    int cur = it->second;
+    for(size_t k = 0 ; k +1 < app.args.size() ; ++k){
+        int v = _partial.find(cur, app.args[k]);
+        if(v == -1){
+            v = newVertex();
+            _partial.insert(cur, app.args[k], v);
+            addNode(cur, app.args[k], v);
+        }
+        cur = v;
+    }
+    addNode(cur, app.args.back(), app.term);
+}
+
+void EqTheory::addApp(const SmtCnf::App& app){
+    assert(_log.empty());
+    curry(app);
+    mergePending();
+}
+
+int EqTheory::newVertex(){
+    int v = _parent.size();
+    _parent.push_back(v);
+    _size.push_back(1);
+    _next.push_back(v);
+    _proof.push_back(make_pair(-1, -1));
+    _mark.push_back(0);
+    _diseqs.emplace_back();
+    _freshAtoms.emplace_back();
+    _use.emplace_back();
+    _edgeMark.push_back(0);
+    _rootMark.push_back(0);
+    _rootDiseq.push_back(false);
+    return v;
+}
+
+void EqTheory::addNode(int left, int right, int term){
+    int n = _nodes.size();
+    _nodes.push_back(Node{left, right, term});
+    int rl = find(left);
+    int rr = find(right);
+    _use[rl].push_back(n);
+    if(rr != rl) _use[rr].push_back(n);
+    int q = findSig(rl, rr);
+    if(q == -1){
+        _sigs.set(rl, rr, n);
+    }
+    else if(find(_nodes[q].term) != find(term)){
+        _congruences.push_back(make_pair(n, q));
+        _pending.push_back(Pending{term, _nodes[q].term, -1 - (int)_congruences.size()});
+    }
+}
+
+int EqTheory::findSig(int rl, int rr) const {
+    int q = _sigs.find(rl, rr);
+    if(q == -1 or find(_nodes[q].left) != rl or find(_nodes[q].right) != rr) return -1;
+    return q;
+}
+
+void EqTheory::addEquality(int a, int b, int label){
+    _pending.push_back(Pending{a, b, label});
+    mergePending();
+}
+
+void EqTheory::mergePending(){
+    for(size_t i = 0 ; i < _pending.size() and _conflict.empty() ; ++i){
+        merge(_pending[i]);
+    }
+    _pending.clear();
+}
+
+void EqTheory::merge(const Pending& p){
+    int a = p.a;
+    int b = p.b;
+    int ra = find(a);
+    int rb = find(b);
+    if(ra == rb) return;
+    if(_size[ra] < _size[rb]){
+        swap(ra, rb);
+        swap(a, b);
+    }
+    // b is in the smallest class.
+    int diseq = checkDiseqs(rb, ra);
+    if(diseq == -1) imply(rb, ra, true);
+    _merges.push_back(Merge{a, b, p.label, rb, _use[ra].size(), _congruences.size()});
+    _parent[rb] = ra;
+    _size[ra] += _size[rb];
+    // splice the two circular lists, doing it again splits them back.
+    swap(_next[ra], _next[rb]);
+    reroot(b);
+    _proof[b] = make_pair(a, p.label);
+    if(p.label < -1) ++_numCongruences;
+    if(diseq != -1){
+        setConflict(diseq);
+        return;
+    }
+    implyDiseqs(rb, ra);
+    // the nodes that use the class of rb get their new signature.
+    for(int n : _use[rb]){
+        const Node& node = _nodes[n];
+        int rl = find(node.left);
+        int rr = find(node.right);
+        int q = findSig(rl, rr);
+        if(q == -1){
+            _sigs.set(rl, rr, n);
+        }
+        else if(q != n and find(_nodes[q].term) != find(node.term)){
+            _congruences.push_back(make_pair(n, q));
+            _pending.push_back(Pending{node.term, _nodes[q].term, -1 - (int)_congruences.size()});
+        }
+        _use[ra].push_back(n);
+    }
+}
+
+void EqTheory::undoMerge(){
+    Merge m = _merges.back();
+    _merges.pop_back();
+    int root = _parent[m.child];
+    _parent[m.child] = m.child;
+    _size[root] -= _size[m.child];
+    swap(_next[root], _next[m.child]);
+    // later reroots may have reversed the edge : cut it on the side that holds it.
+    // The two halves stay proof trees.
+    if(_proof[m.a].second == m.label) _proof[m.a] = make_pair(-1, -1);
+    else{
+        assert(_proof[m.b].second == m.label);
+        _proof[m.b] = make_pair(-1, -1);
+    }
+    _use[root].resize(m.useSize);
+    _congruences.resize(m.congruences);
+}
+
+int EqTheory::checkDiseqs(int small, int big) const {
+    int x = small;
+    do{
+        for(auto& d : _diseqs[x]){
+            if(find(d.first) == big) return d.second;
+        }
+        x = _next[x];
+    } while(x != small);
+    return -1;
+}
+
+void EqTheory::reroot(int v){
+    // reverse the edges on the path from v to the root.
+    pair<int, int> prev(-1, -1);
+    while(v != -1){
+        pair<int, int> up = _proof[v];
+        _proof[v] = prev;
+        prev = make_pair(v, up.second);
+        v = up.first;
+    }
+}
+
+void EqTheory::setConflict(int diseqAtom){
+    _conflict.clear();
+    _conflict.push_back(diseqAtom);
+    _conflictPath = explain(_ker.from[diseqAtom].first, _ker.from[diseqAtom].second, _conflict);
+    _conflictLevel = _log.size();
+    ++_numConflicts;
+    if(_verbose) cout << "Theory conflict on atoms " << _conflict << endl;
+}
+
+void EqTheory::imply(int small, int big, bool val){
+    int x = small;
+    do{
+        // the vertices after the variables of the kernel only have fresh atoms.
+        int begin = x < _ker.numVar ? _ker.adjStart[x] : 0;
+        int end = x < _ker.numVar ? _ker.adjStart[x+1] : 0;
+        for(int i = begin ; i < end ; ++i){
+            const auto& at = _ker.adj[i];
+            if(!_assigned[at.second] and find(at.first) == big){
+                _implied.push_back(SatCnf::Literal{!val, at.second});
+            }
+        }
+        for(const auto& at : _freshAtoms[x]){
+            if(!_assigned[at.second] and find(at.first) == big){
+                _implied.push_back(SatCnf::Literal{!val, at.second});
+            }
+        }
+        x = _next[x];
+    } while(x != small);
+}
+
+void EqTheory::implyDiseqs(int child, int root){
+    ++_rootStamp;
+    // after the splice, the members of the class of child follow root in the list.
+    int first = _next[root];
+    // a class with a disequality to the class of child : all its atoms with the new
+    // class are false.
+    int x = first;
+    for(int k = 0 ; k < _size[child] ; ++k, x = _next[x]){
+        for(const auto& d : _diseqs[x]){
+            int z = find(d.first);
+            if(_rootMark[z] == _rootStamp) continue;
+            _rootMark[z] = _rootStamp;
+            _rootDiseq[z] = true;
+            if(_size[z] <= _size[root]) imply(z, root, false);
+            else imply(root, z, false);
+        }
+    }
+    // the atoms of the class of child to a class with a disequality to the other side.
+    auto check = [&](int atom, int y){
+        if(_assigned[atom]) return;
+        int z = find(y);
+        if(z == root) return;
+        if(_rootMark[z] != _rootStamp){
+            _rootMark[z] = _rootStamp;
+            _rootDiseq[z] = _size[z] <= _size[root] ? checkDiseqs(z, root) != -1 : checkDiseqs(root, z) != -1;
+            // the atoms between z and root are all false : imply them at once.
+            if(_rootDiseq[z]){
+                if(_size[z] <= _size[root]) imply(z, root, false);
+                else imply(root, z, false);
+            }
+        }
+    };
+    x = first;
+    for(int k = 0 ; k < _size[child] ; ++k, x = _next[x]){
+        int begin = x < _ker.numVar ? _ker.adjStart[x] : 0;
+        int end = x < _ker.numVar ? _ker.adjStart[x+1] : 0;
+        for(int i = begin ; i < end ; ++i){
+            check(_ker.adj[i].second, _ker.adj[i].first);
+        }
+        for(const auto& at : _freshAtoms[x]){
+            check(at.second, at.first);
+        }
+    }
+}
+
+bool EqTheory::explain(int a, int b, vector<int>& atoms){
+    ++_edgeStamp;
+    _toExplain.clear();
+    _toExplain.push_back(make_pair(a, b));
+    bool path = true;
+    // the arguments of a congruence are equal by older edges : this ends.
+    for(size_t i = 0 ; i < _toExplain.size() ; ++i){
+        path &= explainPath(_toExplain[i].first, _toExplain[i].second, atoms);
+    }
+    return path;
+}
+
+bool EqTheory::explainPath(int a, int b, vector<int>& atoms){
+    assert(find(a) == find(b));
+    if(a == b) return true;
+    // step up from a and b alternately, the first vertex seen twice is the nearest common ancestor.
+    ++_stamp;
+    int x = a, y = b, nca = -1;
+    while(nca == -1){
+        if(x != -1){
+            if(_mark[x] == _stamp) nca = x;
+            _mark[x] = _stamp;
+            x = _proof[x].first;
+        }
+        if(y != -1 and nca == -1){
+            if(_mark[y] == _stamp) nca = y;
+            _mark[y] = _stamp;
+            y = _proof[y].first;
+        }
+    }
+    bool path = true;
+    auto edge = [&](int v){
+        if(_edgeMark[v] == _edgeStamp) return; // already explained
+        _edgeMark[v] = _edgeStamp;
+        int label = _proof[v].second;
+        if(label >= 0){
+            atoms.push_back(label);
+            return;
+        }
+        path = false;
+        const Node& n = _nodes[_congruences[-2 - label].first];
+        const Node& q = _nodes[_congruences[-2 - label].second];
+        _toExplain.push_back(make_pair(n.left, q.left));
+        _toExplain.push_back(make_pair(n.right, q.right));
+    };
+    for(int v = a ; v != nca ; v = _proof[v].first){
+        edge(v);
+    }
+    // the second half is walked from b : reverse it.
+    size_t half = atoms.size();
+    for(int v = b ; v != nca ; v = _proof[v].first){
+        edge(v);
+    }
+    reverse(atoms.begin() + half, atoms.end());
+    return path;
+}
+
+int EqTheory::atom(int a, int b){
+    if(b < a) swap(a, b);
+    int res = _ker.to.find(a, b);
+    if(res != -1) return res;
+    res = newVar();
+    assert(res == (int)_ker.from.size());
+    _ker.to.insert(a, b, res);
+    _ker.from.push_back(make_pair(a, b));
+    _assigned.push_back(false);
+    _freshAtoms[a].push_back(make_pair(b, res));
+    _freshAtoms[b].push_back(make_pair(a, res));
+    return res;
+}
+
+bool EqTheory::cutConflict(SatCnf::Clause& cl, vector<SatCnf::Clause>& defs){
+    size_t k = _conflict.size() -1;
+    int a = _ker.from[_conflict[0]].first;
+    // vertices of the path, v[i] is the end of the equality _conflict[i].
+    vector<int> v(k+1);
+    v[0] = a;
+    for(size_t i = 1 ; i <= k ; ++i){
+        auto& p = _ker.from[_conflict[i]];
+        v[i] = p.first == v[i-1] ? p.second : p.first;
+    }
+    // the existing atoms a = v[i] must not be in the model.
+    for(size_t i = 2 ; i < k ; ++i){
+        int x = v[i] < a ? _ker.to.find(v[i], a) : _ker.to.find(a, v[i]);
+        if(x != -1 and _assigned[x]) return false;
+    }
+    int prev = _conflict[1]; // a = v[1]
+    for(size_t i = 2 ; i < k ; ++i){
+        size_t numAtoms = _ker.from.size();
+        int cur = atom(a, v[i]);
+        _numFreshAtoms += _ker.from.size() - numAtoms;
+        SatCnf::Clause def;
+        def.literals.push_back(SatCnf::Literal{true, prev});
+        def.literals.push_back(SatCnf::Literal{true, _conflict[i]});
+        def.literals.push_back(SatCnf::Literal{false, cur});
+        defs.push_back(move(def));
+        prev = cur;
+    }
+    cl.literals.clear();
+    cl.literals.push_back(SatCnf::Literal{false, _conflict[0]});
+    cl.literals.push_back(SatCnf::Literal{true, prev});
+    cl.literals.push_back(SatCnf::Literal{true, _conflict[k]});
+    return true;
+}
+
+void EqTheory::assign(int var, bool val){
+    int a = _ker.from[var].first;
+    int b = _ker.from[var].second;
+    Undo u{var, val, _merges.size()};
+    _assigned[var] = true;
+    // nothing is merged during a conflict : it is undone before the conflict ends.
+    if(val){
+        addEquality(a, b, var);
+    }
+    else{
+        _diseqs[a].push_back(make_pair(b, var));
+        _diseqs[b].push_back(make_pair(a, var));
+        int ra = find(a);
+        int rb = find(b);
+        if(ra == rb){
+            if(_conflict.empty()) setConflict(var);
+        }
+        else if(_conflict.empty()){
+            if(_size[ra] < _size[rb]) swap(ra, rb);
+            imply(rb, ra, false);
+        }
+    }
+    _log.push_back(u);
+}
+
+void EqTheory::unassign(){
+    assert(!_log.empty());
+    Undo u = _log.back();
+    _log.pop_back();
+    _assigned[u.atom] = false;
+    // the implications may depend on this atom.
+    _implied.clear();
+    _impliedHead = 0;
+    int a = _ker.from[u.atom].first;
+    int b = _ker.from[u.atom].second;
+    if(u.val){
+        while(_merges.size() > u.merges){
+            undoMerge();
+        }
+    }
+    else{
+        _diseqs[a].pop_back();
+        _diseqs[b].pop_back();
+    }
+    if(_log.size() <= _conflictLevel) _conflict.clear();
+}
+
+bool EqTheory::conflict(SatCnf::Clause& cl, vector<SatCnf::Clause>& defs){
+    if(_conflict.empty()) return false;
+    if(newVar and _conflictPath and _conflict.size() > minCutLength and cutConflict(cl, defs)){
+        _conflict.clear();
+        return true;
+    }
+    cl.literals.clear();
+    // the first atom is the false disequality, the others are true equalities.
+    cl.literals.push_back(SatCnf::Literal{false, _conflict[0]});
+    for(size_t i = 1 ; i < _conflict.size() ; ++i){
+        cl.literals.push_back(SatCnf::Literal{true, _conflict[i]});
+    }
+    _conflict.clear();
+    return true;
+}
+
+bool EqTheory::propagate(SatCnf::Literal& lit){
+    if(!_conflict.empty()) return false;
+    while(_impliedHead < _implied.size()){
+        lit = _implied[_impliedHead++];
+        if(_assigned[lit.var]) continue;
+        ++_numPropagations;
+        return true;
+    }
+    _implied.clear();
+    _impliedHead = 0;
+    return false;
+}
+
+void EqTheory::explain(SatCnf::Literal lit, SatCnf::Clause& cl){
+    assert(_assigned[lit.var]);
+    int a = _ker.from[lit.var].first;
+    int b = _ker.from[lit.var].second;
+    vector<int> eqs;
+    cl.literals.clear();
+    cl.literals.push_back(lit);
+    if(!lit.neg){ // a = b : the path of the proof forest, implied atoms are never on it.
+        explain(a, b, eqs);
+    }
+    else{ // a <> b : a disequality c <> d with a = c and b = d.
+        int rb = find(b);
+        assert(find(a) != rb);
+        int x = a;
+        do{
+            for(auto& d : _diseqs[x]){
+                if(d.second == lit.var or find(d.first) != rb) continue;
+                cl.literals.push_back(SatCnf::Literal{false, d.second});
+                explain(a, x, eqs);
+                explain(b, d.first, eqs);
+                x = -1;
+                break;
+            }
+            if(x == -1) break;
+            x = _next[x];
+        } while(x != a);
+        assert(x == -1);
+    }
+    for(int e : eqs){
+        cl.literals.push_back(SatCnf::Literal{true, e});
+    }
+}
+
+int EqTheory::phase(int var){
+    int ra = find(_ker.from[var].first);
+    int rb = find(_ker.from[var].second);
+    // the union-find state is the value most likely to hold : a = b in the same
+    // class, a <> b otherwise (merging two classes is what creates conflicts).
+    return ra == rb ? 1 : 0;
+}
+
+vector<int> EqTheory::classes() const {
+    vector<int> res(_ker.numVar);
+    for(int i = 0 ; i < _ker.numVar ; ++i){
+        res[i] = find(i);
+    }
+    return res;
+}
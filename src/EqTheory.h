@@ -0,0 +1,240 @@
+#ifndef EQTHEORY_H
+#define EQTHEORY_H
+
+#include <map>
+#include <utility>
+#include <vector>
+#include "SatTheory.h"
+#include "SmtSolver.h"
+
+/**
+   @brief Online equality theory for the SAT variables of a SmtSatKernel.
+
+   The classes of the true equalities are kept in a union-find without path
+   compression (union by size) so that each union can be undone in O(1) from
+   a log. Each class is also a circular list of its members.
+
+   Explanations come from a proof forest (Nieuwenhuis and Oliveras) : each
+   union adds an edge labelled by its atom between the two vertices of the atom,
+   after rerooting the tree of the smallest class at its vertex. The path between
+   two vertices of a class goes through their nearest common ancestor, found by
+   stepping up from both sides alternately, so an explanation costs its length.
+
+   The true disequalities are stored on their two vertices. On a union, the
+   disequalities of the smallest class are checked against the other class,
+   so the theory detects a conflict at the assignment that creates it.
+
+   Propagation : on a union, the unassigned atoms between the smallest class and
+   the other one are implied true, and the atoms between the new class and a class
+   with a disequality to it are implied false : the classes found from the
+   disequalities of the smallest class, and the ones that the atoms of the smallest
+   class lead to. On a new disequality, the unassigned atoms between the two classes
+   are implied false.
+
+   Long conflicts a = v1 = ... = vk = b, a <> b are cut in triangles with
+   the atoms a = v2, ..., a = vk-1 : each one is defined from the previous one
+   by a clause of 3 literals, and the conflict clause has 3 literals. The atoms
+   that do not exist yet are created (in the kernel and in the solver) and
+   reused by the next conflicts.
+
+   Decisions : an atom is decided true if its two vertices are in the same class,
+   false otherwise, instead of the saved phase of the solver.
+
+   Uninterpreted functions : the applications are curried in binary nodes
+   term = left(right), where left is a function or a partial application (extra
+   vertices after the variables of the kernel). Each class has the list of the
+   nodes that use one of its vertices, and the signatures (root of left, root of
+   right) are in a hash table. On a union, the nodes of the smallest class get their
+   new signature : a node that has the signature of another one is congruent to it,
+   and their terms are merged too, with a proof edge labelled by the two nodes.
+   Each node is moved O(log n) times. The table is not undone : an entry is checked
+   against the current signature of its node, and replaced if it is stale.
+   A congruence edge is explained by the paths between the arguments of its nodes.
+
+   Terms, atoms and applications can be added between two searches (see
+   SmtIncremental), the atoms added this way are handled as the fresh ones.
+ */
+class EqTheory : public SatTheory{
+    SmtSatKernel& _ker;
+    bool _verbose;
+
+    // union-find
+    std::vector<int> _parent;
+    std::vector<int> _size;
+    std::vector<int> _next; // next member in the class (circular list)
+
+    // proof forest : parent of each vertex and atom of the edge, (-1, -1) for roots.
+    std::vector<std::pair<int, int>> _proof;
+    // marks of the nearest common ancestor search, a vertex is marked if equal to _stamp.
+    std::vector<size_t> _mark;
+    size_t _stamp = 0;
+
+    // true disequalities on each vertex : (other vertex, atom)
+    std::vector<std::vector<std::pair<int, int>>> _diseqs;
+    std::vector<bool> _assigned; // atoms in the model
+    // atoms created during the search on each vertex : (other vertex, atom)
+    std::vector<std::vector<std::pair<int, int>>> _freshAtoms;
+
+    // curried applications : term = left(right).
+    struct Node{
+        int left;
+        int right;
+        int term;
+    };
+    std::vector<Node> _nodes;
+    // vertex of each (function, arity), and partial application of each (left, right).
+    std::map<std::pair<int, size_t>, int> _funs;
+    AtomTable _partial;
+    // nodes that use a vertex of each class (valid for the roots).
+    std::vector<std::vector<int>> _use;
+    // node of each signature, see above.
+    AtomTable _sigs;
+    // nodes of the congruence edges of the proof forest : edge i is labelled -2-i
+    // (the labels of the other edges are their atoms).
+    std::vector<std::pair<int, int>> _congruences;
+
+    // unions to do, with the label of their proof edge.
+    struct Pending{
+        int a;
+        int b;
+        int label;
+    };
+    std::vector<Pending> _pending;
+    // What a union has done, to undo it.
+    struct Merge{
+        int a; // the edge labelled label is on a or b.
+        int b;
+        int label;
+        int child; // root merged into the other one
+        size_t useSize; // size of the use list of the other root before the union
+        size_t congruences; // size of _congruences before the union
+    };
+    std::vector<Merge> _merges;
+
+    // What an assignment has done, to undo it.
+    struct Undo{
+        int atom;
+        bool val;
+        size_t merges; // size of _merges before the assignment
+    };
+    std::vector<Undo> _log;
+
+    // pairs of vertices left to explain, and marks of the explained edges (on their child).
+    std::vector<std::pair<int, int>> _toExplain;
+    std::vector<size_t> _edgeMark;
+    size_t _edgeStamp = 0;
+    // roots already checked by the last implyDiseqs, if _rootMark is _rootStamp, and
+    // whether they have a disequality to the new class.
+    std::vector<size_t> _rootMark;
+    std::vector<bool> _rootDiseq;
+    size_t _rootStamp = 0;
+
+    // Atoms of the current conflict, empty if none.
+    std::vector<int> _conflict;
+    // The conflict is a path of equalities (no congruence).
+    bool _conflictPath = false;
+    // _log size when the conflict was found.
+    size_t _conflictLevel = 0;
+
+    // Implied literals not given to the solver yet, from _impliedHead.
+    std::vector<SatCnf::Literal> _implied;
+    size_t _impliedHead = 0;
+
+    // statistics
+    size_t _numConflicts = 0;
+    size_t _numPropagations = 0;
+    size_t _numFreshAtoms = 0;
+    size_t _numCongruences = 0;
+
+    int find(int v) const {
+        while(_parent[v] != v) v = _parent[v];
+        return v;
+    }
+    // Add a vertex without any atom (function or partial application).
+    int newVertex();
+    // Add a node and look for a congruent one.
+    void addNode(int left, int right, int term);
+    // Add the nodes of an application, its congruences are left in _pending.
+    void curry(const SmtCnf::App& app);
+    // Do the unions of _pending (and the ones they create) until a conflict.
+    void mergePending();
+    // Node with the signature (rl, rr) of two roots, -1 if none.
+    int findSig(int rl, int rr) const;
+    // Union of the classes of a and b, with its proof edge, then the congruences it creates.
+    void addEquality(int a, int b, int label);
+    // One union of addEquality.
+    void merge(const Pending& p);
+    // Undo the last union.
+    void undoMerge();
+    // A disequality between the class of small and the class of root big, -1 if none.
+    int checkDiseqs(int small, int big) const;
+    // Make v the root of its proof tree.
+    void reroot(int v);
+    // Set the conflict to the disequality atom and the equalities that contradict it.
+    void setConflict(int diseqAtom);
+    // Imply the unassigned atoms between the class of small and the class of root big.
+    void imply(int small, int big, bool val);
+    // After the union of the class of child into root, imply the atoms between the
+    // new class and the classes with a disequality to it (see above).
+    void implyDiseqs(int child, int root);
+    // Atoms that explain a = b (they must be in the same class). Without congruence, they
+    // are the proof forest path from a to b and it returns true.
+    bool explain(int a, int b, std::vector<int>& atoms);
+    // Atoms of the proof forest path between a and b, the congruences are added to _toExplain.
+    bool explainPath(int a, int b, std::vector<int>& atoms);
+    // Atom a = b, created if needed.
+    int atom(int a, int b);
+    // Cut the current conflict in triangles (see above), return false if it can't be done.
+    bool cutConflict(SatCnf::Clause& cl, std::vector<SatCnf::Clause>& defs);
+
+public:
+    // The conflicts of at least this number of equalities are cut in triangles.
+    static const size_t minCutLength = 4;
+
+    // ker gets the atoms created during the search. The terms of apps are variables of ker.
+    EqTheory(SmtSatKernel& ker, bool verbose,
+             const std::vector<SmtCnf::App>& apps = std::vector<SmtCnf::App>());
+
+    void assign(int var, bool val) override;
+    void unassign() override;
+    bool conflict(SatCnf::Clause& cl, std::vector<SatCnf::Clause>& defs) override;
+    bool propagate(SatCnf::Literal& lit) override;
+    void explain(SatCnf::Literal lit, SatCnf::Clause& cl) override;
+    int phase(int var) override;
+
+    // Class of each SMT variable (the id of its root).
+    std::vector<int> classes() const;
+
+    // Incremental use : the terms, atoms and applications can also be added after
+    // the construction, the variables of the kernel are then only the first terms.
+    // Add a term and return its vertex.
+    int addTerm(){
+        return newVertex();
+    }
+    // Atom between two vertices, created (in the kernel and in the solver) if needed.
+    int addAtom(int a, int b){
+        return atom(a, b);
+    }
+    // Add the application app.term = app.fun(app.args) of vertices, while no atom is
+    // assigned : its congruences are merged for good.
+    void addApp(const SmtCnf::App& app);
+    // Root of the class of vertex v.
+    int root(int v) const {
+        return find(v);
+    }
+
+    size_t numConflicts() const {
+        return _numConflicts;
+    }
+    size_t numPropagations() const {
+        return _numPropagations;
+    }
+    size_t numFreshAtoms() const {
+        return _numFreshAtoms;
+    }
+    size_t numCongruences() const {
+        return _numCongruences;
+    }
+};
+
+#endif
@@ -0,0 +1,185 @@
+#include "InputBuffer.h"
+#include "Decompress.h"
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <ios>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+// Bytes of a file descriptor, by read().
+class FdSource : public InputSource{
+    int _fd;
+public:
+    explicit FdSource(int fd) : _fd(fd){}
+    size_t read(char* buf, size_t n) override {
+        while(true){
+            ssize_t r = ::read(_fd, buf, n);
+            if(r >= 0) return r;
+            if(errno != EINTR) throw ios_base::failure("Read error");
+        }
+    }
+};
+
+// Bytes of a memory block.
+class MemorySource : public InputSource{
+    const char* _cur;
+    const char* _end;
+public:
+    MemorySource(const char* data, size_t size) : _cur(data), _end(data + size){}
+    size_t read(char* buf, size_t n) override {
+        n = min(n, size_t(_end - _cur));
+        memcpy(buf, _cur, n);
+        _cur += n;
+        return n;
+    }
+};
+
+// Bytes of head, then the bytes of rest.
+class PrefixSource : public InputSource{
+    string _head;
+    size_t _pos = 0;
+    unique_ptr<InputSource> _rest;
+public:
+    PrefixSource(string head, unique_ptr<InputSource> rest) : _head(move(head)), _rest(move(rest)){}
+    size_t read(char* buf, size_t n) override {
+        if(_pos == _head.size()) return _rest->read(buf, n);
+        n = min(n, _head.size() - _pos);
+        memcpy(buf, _head.data() + _pos, n);
+        _pos += n;
+        return n;
+    }
+};
+}
+
+InputBuffer::InputBuffer(const string& filename){
+    _fd = filename == "-" ? 0 : ::open(filename.c_str(), O_RDONLY);
+    if(_fd < 0) throw ios_base::failure("Can't open " + filename);
+    struct stat st;
+    // an empty file can't be mapped, it is read as a pipe.
+    if(fstat(_fd, &st) == 0 and S_ISREG(st.st_mode) and st.st_size > 0){
+        void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, _fd, 0);
+        if(map != MAP_FAILED){
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            _map = static_cast<const char*>(map);
+            _mapSize = st.st_size;
+        }
+    }
+    try{
+        openSource();
+    }
+    catch(...){
+        release();
+        throw;
+    }
+    if(_source){
+        _buf.resize(blockSize + 1);
+        _base = _cur = _limit = _end = _buf.data();
+    }
+    else{
+        _base = _cur = _map;
+        _end = _map + _mapSize;
+        _limit = _mapSize > margin ? _end - margin : _map;
+    }
+    // the error messages use errno only if the input can't be read.
+    errno = 0;
+}
+
+void InputBuffer::openSource(){
+    if(_map){
+        // a compressed file is mapped too, its decompressor reads the map.
+        Compression c = compression(_map, _mapSize);
+        if(c != Compression::NONE){
+            _source = decompress(c, unique_ptr<InputSource>(new MemorySource(_map, _mapSize)));
+        }
+    }
+    else{
+        // the magic number read from a pipe is given back to the next reader.
+        unique_ptr<InputSource> fd(new FdSource(_fd));
+        char head[magicSize];
+        size_t n = 0;
+        while(n < magicSize){
+            size_t r = fd->read(head + n, magicSize - n);
+            if(r == 0) break;
+            n += r;
+        }
+        _source = decompress(compression(head, n),
+                             unique_ptr<InputSource>(new PrefixSource(string(head, n), move(fd))));
+    }
+}
+
+InputBuffer::InputBuffer(unique_ptr<InputSource> source) : _source(move(source)), _buf(blockSize + 1){
+    _base = _cur = _limit = _end = _buf.data();
+}
+
+InputBuffer::~InputBuffer(){
+    release();
+}
+
+void InputBuffer::release(){
+    if(_map) munmap(const_cast<char*>(_map), _mapSize);
+    if(_fd > 0) close(_fd);
+}
+
+void InputBuffer::refill(){
+    if(_last) return;
+    size_t keep = _end - _cur;
+    _offset += _cur - _base;
+    if(_map and _base == _map){
+        // the tail of the map, where the scanner needs the 0 byte.
+        _buf.assign(_cur, _end);
+        _buf.push_back(0);
+        _base = _cur = _buf.data();
+        _limit = _end = _cur + keep;
+        _last = true;
+        return;
+    }
+    char* buf = _buf.data();
+    memmove(buf, _cur, keep);
+    size_t n = keep;
+    // a pipe can give less than asked : read until the chunk has more than margin bytes.
+    while(n <= margin){
+        size_t r = _source->read(buf + n, blockSize - n);
+        if(r == 0){
+            _last = true;
+            break;
+        }
+        n += r;
+    }
+    buf[n] = 0;
+    _base = _cur = buf;
+    _end = buf + n;
+    _limit = _last ? _end : _end - margin;
+}
+
+void InputBuffer::skipLine(){
+    while(true){
+        if(_cur >= _limit) refill();
+        const char* nl = static_cast<const char*>(memchr(_cur, '\n', _end - _cur));
+        if(nl){
+            _cur = nl + 1;
+            return;
+        }
+        _cur = _end;
+        if(_last) return;
+    }
+}
+
+size_t InputBuffer::read(char* dst, size_t n){
+    size_t done = 0;
+    while(done < n){
+        if(_cur >= _limit) refill();
+        // the bytes after _limit can be copied, only a token must not cross _end.
+        size_t len = min(size_t(_end - _cur), n - done);
+        if(len == 0) break;
+        memcpy(dst + done, _cur, len);
+        _cur += len;
+        done += len;
+    }
+    return done;
+}
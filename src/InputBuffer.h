@@ -0,0 +1,136 @@
+#ifndef INPUTBUFFER_H
+#define INPUTBUFFER_H
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+   @brief Producer of the bytes of an input : read() fills buf with at most n
+   bytes and returns their number, 0 at the end of the input.
+ */
+class InputSource{
+public:
+    virtual ~InputSource(){}
+    virtual size_t read(char* buf, size_t n) = 0;
+};
+
+/**
+   @brief Input of the parsers of SatCnf and SmtCnf.
+
+   A regular file is mapped in memory and scanned in place. Any other input
+   (a pipe, the standard input) is read by blocks of blockSize bytes from an
+   InputSource. A compressed input is read by blocks from its decompressor
+   (see Decompress.h). The scanner works on a chunk [cur, end) of the map or of the
+   block buffer. The chunk is refilled when cur reaches limit, which is
+   `margin` bytes before its end unless it is the last one, so a token read
+   from before limit never crosses the end of a chunk. The tail of the input
+   is copied into the block buffer, followed by a 0 byte.
+
+   The integer scanning has no bound check : it stops at a non digit and at
+   maxDigits digits, which is less than margin.
+ */
+class InputBuffer{
+    int _fd = -1;
+    // mapped file, nullptr if the input is read by blocks.
+    const char* _map = nullptr;
+    size_t _mapSize = 0;
+    std::unique_ptr<InputSource> _source;
+    std::vector<char> _buf;
+
+    // the current chunk starts at _base.
+    const char* _base = nullptr;
+    const char* _cur = nullptr;
+    const char* _limit = nullptr;
+    const char* _end = nullptr;
+    // no data after _end.
+    bool _last = false;
+    // bytes before the current chunk.
+    size_t _offset = 0;
+
+    // Set _source if the file is read by blocks : it is not mapped, or it is compressed.
+    void openSource();
+    // Unmap and close the file.
+    void release();
+    // Get the next chunk, keeping the bytes of [_cur, _end).
+    void refill();
+
+public:
+    static const size_t blockSize = 1 << 20;
+    static const size_t margin = 64;
+    static const int maxDigits = 18;
+
+    // Open a file, "-" is the standard input. A gzip, xz or zstd input is
+    // decompressed. Throws std::ios_base::failure if it can't be opened (errno
+    // is then set) or if its compression is not supported.
+    explicit InputBuffer(const std::string& filename);
+    // Read the bytes of source by blocks.
+    explicit InputBuffer(std::unique_ptr<InputSource> source);
+    ~InputBuffer();
+    InputBuffer(const InputBuffer&) = delete;
+    InputBuffer& operator=(const InputBuffer&) = delete;
+
+    // Next byte, EOF at the end of the input.
+    int peek(){
+        if(_cur >= _limit) refill();
+        return _cur < _end ? (unsigned char)*_cur : EOF;
+    }
+    // Skip the byte given by peek().
+    void skip(){
+        ++_cur;
+    }
+    // Skip spaces, tabs and \r.
+    void skipSpaces(){
+        int c = peek();
+        while(c == ' ' or c == '\t' or c == '\r'){
+            ++_cur;
+            c = peek();
+        }
+    }
+    // Skip the rest of the line and its \n.
+    void skipLine();
+    // Read a decimal integer (with an optional -). Return false if there is
+    // none or if it does not fit in an int, nothing is skipped then.
+    bool readInt(int& value){
+        if(_cur >= _limit) refill();
+        const char* p = _cur;
+        bool neg = p < _end and *p == '-';
+        p += neg;
+        const char* digits = p;
+        long long v = 0;
+        while(p < digits + maxDigits and (unsigned)(*p - '0') < 10){
+            v = v*10 + (*p - '0');
+            ++p;
+        }
+        if(p == digits or v > 0x7fffffff or (unsigned)(*p - '0') < 10) return false;
+        value = neg ? -v : v;
+        _cur = p;
+        return true;
+    }
+
+    // Copy the next n bytes to dst, return their number (less than n at the end).
+    size_t read(char* dst, size_t n);
+
+    // Bytes that can be scanned in place : [chunk(), chunk() + available()), at
+    // least margin bytes unless the input ends before, none at the end. They
+    // stay in place until the next call of a method that reads.
+    const char* chunk(){
+        if(_cur >= _limit) refill();
+        return _cur;
+    }
+    size_t available() const {
+        return _end - _cur;
+    }
+    // Skip n bytes of the chunk.
+    void skip(size_t n){
+        _cur += n;
+    }
+
+    // Number of bytes consumed.
+    size_t position() const {
+        return _offset + (_cur - _base);
+    }
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "LocalSearch.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+using namespace std;
+
+// number of precomputed break count probabilities, higher counts use the last one.
+static const int maxBreak = 64;
+
+LocalSearch::LocalSearch(size_t numVar, unsigned seed)
+    : _numVar(numVar), _start(1, 0), _occurs(2*numVar), _breaks(numVar), _rng(seed){
+}
+
+LocalSearch::LocalSearch(const SatCnf& sc, unsigned seed) : LocalSearch(sc._numVar, seed){
+    for(const auto& cl : sc.clauses){
+        addClause(cl);
+    }
+}
+
+void LocalSearch::addVar(){
+    ++_numVar;
+    _occurs.resize(2*_numVar);
+    _breaks.resize(_numVar);
+}
+
+void LocalSearch::addClause(SatCnf::ClauseRef cl){
+    vector<int> lits;
+    lits.reserve(cl.literals.size());
+    for(auto lit : cl.literals){
+        lits.push_back(2*lit.var + lit.neg);
+    }
+    addClause(move(lits));
+}
+
+void LocalSearch::addClause(vector<int> lits){
+    sort(lits.begin(), lits.end());
+    lits.erase(unique(lits.begin(), lits.end()), lits.end());
+    if(lits.empty()) return;
+    for(size_t i = 1 ; i < lits.size() ; ++i){
+        if((lits[i-1] >> 1) == (lits[i] >> 1)) return; // x v ¬x
+    }
+    int c = numClauses();
+    for(int lit : lits){
+        assert(size_t(lit >> 1) < _numVar);
+        _lits.push_back(lit);
+        _occurs[lit].push_back(c);
+    }
+    _start.push_back(_lits.size());
+    _maxLen = max(_maxLen, lits.size());
+}
+
+// ProbSAT polynomial break function (eps + b)^-cb, with the cb values of the
+// ProbSAT paper for the maximal clause length.
+void LocalSearch::computeProbs(){
+    double cb = _maxLen <= 3 ? 2.06 : _maxLen <= 4 ? 3.0 : _maxLen <= 5 ? 3.7 : 5.1;
+    double eps = 0.9;
+    _probs.resize(maxBreak +1);
+    for(int b = 0 ; b <= maxBreak ; ++b){
+        _probs[b] = pow(eps + b, -cb);
+    }
+}
+
+void LocalSearch::init(const vector<bool>& assign){
+    assert(assign.size() == _numVar);
+    _assign = assign;
+    size_t nc = numClauses();
+    _numTrue.assign(nc, 0);
+    _critVar.assign(nc, 0);
+    _breaks.assign(_numVar, 0);
+    _unsat.clear();
+    _unsatPos.assign(nc, -1);
+    for(size_t c = 0 ; c < nc ; ++c){
+        for(size_t i = _start[c] ; i < _start[c+1] ; ++i){
+            if(isTrue(_lits[i])){
+                _numTrue[c]++;
+                _critVar[c] ^= _lits[i] >> 1;
+            }
+        }
+        if(_numTrue[c] == 0) makeUnsat(c);
+        else if(_numTrue[c] == 1) _breaks[_critVar[c]]++;
+    }
+}
+
+void LocalSearch::flip(int var){
+    // literal of var that becomes true and the one that becomes false.
+    int becomeTrue = 2*var + _assign[var];
+    int becomeFalse = becomeTrue ^ 1;
+    _assign[var] = !_assign[var];
+    for(int c : _occurs[becomeTrue]){
+        int nt = ++_numTrue[c];
+        if(nt == 1){
+            makeSat(c);
+            _breaks[var]++;
+        }
+        else if(nt == 2){
+            _breaks[_critVar[c]]--;
+        }
+        _critVar[c] ^= var;
+    }
+    for(int c : _occurs[becomeFalse]){
+        int nt = --_numTrue[c];
+        _critVar[c] ^= var;
+        if(nt == 0){
+            makeUnsat(c);
+            _breaks[var]--;
+        }
+        else if(nt == 1){
+            _breaks[_critVar[c]]++;
+        }
+    }
+    ++_flips;
+}
+
+bool LocalSearch::run(vector<bool>& assign, unsigned long long maxFlips){
+    auto begin = chrono::steady_clock::now();
+    computeProbs();
+    init(assign);
+    size_t best = _unsat.size();
+    vector<double> weights;
+    unsigned long long flips = 0;
+    while(!_unsat.empty() and flips < maxFlips){
+        int c = _unsat[_rng() % _unsat.size()];
+        size_t len = _start[c+1] - _start[c];
+        const int* lits = &_lits[_start[c]];
+        weights.resize(len);
+        double sum = 0;
+        for(size_t i = 0 ; i < len ; ++i){
+            sum += weights[i] = _probs[min(_breaks[lits[i] >> 1], maxBreak)];
+        }
+        double r = uniform_real_distribution<double>(0, sum)(_rng);
+        size_t i = 0;
+        for(; i +1 < len ; ++i){
+            r -= weights[i];
+            if(r <= 0) break;
+        }
+        flip(lits[i] >> 1);
+        ++flips;
+        if(_unsat.size() < best){
+            best = _unsat.size();
+            assign = _assign;
+        }
+    }
+    _seconds += chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    if(_unsat.empty()){
+        assign = _assign;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,96 @@
+#ifndef LOCALSEARCH_H
+#define LOCALSEARCH_H
+
+#include <vector>
+#include <random>
+#include "SatCnf.h"
+
+/**
+   @brief ProbSAT stochastic local search.
+
+   Literals are encoded as 2*var + neg, like the literals of the SAT solver.
+   The engine keeps for each clause its number of true literals and, when there is
+   only one, which variable it is (critical variable). From that, the break
+   count of each variable (number of clauses that become false if it is flipped)
+   and the list of false clauses are maintained on each flip.
+
+   At each step, a random false clause is picked and one of its variables is
+   flipped with a probability decreasing with its break count.
+ */
+class LocalSearch{
+    size_t _numVar;
+    // clause c is _lits[_start[c]] ... _lits[_start[c+1] -1]
+    std::vector<int> _lits;
+    std::vector<size_t> _start;
+    // clauses containing each literal.
+    std::vector<std::vector<int>> _occurs;
+
+    std::vector<bool> _assign;
+    std::vector<int> _numTrue; // per clause
+    std::vector<int> _critVar; // per clause : xor of the vars of its true literals
+    std::vector<int> _breaks; // per variable
+    std::vector<int> _unsat; // false clauses
+    std::vector<int> _unsatPos; // position of each false clause in _unsat, -1 if true
+
+    std::mt19937 _rng;
+    std::vector<double> _probs; // probability weight for each break count
+    size_t _maxLen = 0;
+
+    // statistics
+    unsigned long long _flips = 0;
+    double _seconds = 0;
+
+    size_t numClauses() const {
+        return _start.size() -1;
+    }
+    bool isTrue(int lit) const {
+        return _assign[lit >> 1] ^ (lit & 1);
+    }
+    void makeUnsat(int c){
+        _unsatPos[c] = _unsat.size();
+        _unsat.push_back(c);
+    }
+    void makeSat(int c){
+        int last = _unsat.back();
+        _unsat[_unsatPos[c]] = last;
+        _unsatPos[last] = _unsatPos[c];
+        _unsat.pop_back();
+        _unsatPos[c] = -1;
+    }
+    void init(const std::vector<bool>& assign); // compute all tables from an assignment.
+    void flip(int var);
+    void computeProbs();
+public:
+    explicit LocalSearch(size_t numVar, unsigned seed = 0);
+    explicit LocalSearch(const SatCnf& sc, unsigned seed = 0);
+
+    // Add a variable, its index is the previous number of variables.
+    void addVar();
+
+    // Add a clause (literals as 2*var + neg). Tautologies and empty clauses are ignored.
+    void addClause(std::vector<int> lits);
+    void addClause(SatCnf::ClauseRef cl);
+
+    /**
+       Search for a model starting from assign, with at most maxFlips flips.
+       On return assign is the model if one was found (returns true)
+       or else the best assignment met (fewest false clauses).
+     */
+    bool run(std::vector<bool>& assign, unsigned long long maxFlips);
+
+    // Number of false clauses at the end of the last run.
+    size_t numUnsat() const {
+        return _unsat.size();
+    }
+
+    // Total number of flips done by this engine.
+    unsigned long long flips() const {
+        return _flips;
+    }
+    // Throughput of all the runs of this engine.
+    double flipsPerSecond() const {
+        return _seconds > 0 ? _flips / _seconds : 0;
+    }
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+/// Number of worker threads available on this machine (at least 1).
+inline size_t workerCount(){
+    size_t n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+/**
+   @brief Run fn(worker, i) for every i in [0,n) on at most maxThreads threads.
+
+   Indices are handed out dynamically, so the call order is unspecified.
+   worker is in [0, number of threads) and lets the caller keep one buffer per
+   thread. If maxThreads is 0, @ref workerCount is used.
+   The calling thread takes part in the work, so with one thread nothing is spawned.
+ */
+template<typename F>
+void parallelFor(size_t n, F fn, size_t maxThreads = 0){
+    if(!maxThreads) maxThreads = workerCount();
+    size_t nThreads = std::min(n, maxThreads);
+    if(nThreads <= 1){
+        for(size_t i = 0 ; i < n ; ++i) fn(size_t(0), i);
+        return;
+    }
+    std::atomic<size_t> next(0);
+    auto work = [&](size_t worker){
+        for(size_t i = next++ ; i < n ; i = next++){
+            fn(worker, i);
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(nThreads -1);
+    for(size_t t = 1 ; t < nThreads ; ++t){
+        threads.emplace_back(work, t);
+    }
+    work(0);
+    for(auto& th : threads) th.join();
+}
+
+/**
+   @brief Threads kept for several parallel loops, parked on a condition variable
+   between two calls of run().
+
+   run(n, fn) does what parallelFor(n, fn, size()) does, without starting threads :
+   the calling thread takes part in the work and worker 0 is the caller. Only one
+   thread at a time may call run().
+ */
+class WorkerPool{
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _start;
+    std::condition_variable _done;
+    // the loop of the current call, and its next index.
+    const std::function<void(size_t, size_t)>* _fn = nullptr;
+    size_t _n = 0;
+    std::atomic<size_t> _next{0};
+    // incremented by each call, so that a worker runs each loop once.
+    size_t _generation = 0;
+    // workers still in the current loop.
+    size_t _busy = 0;
+    bool _stop = false;
+
+    void work(size_t worker){
+        for(size_t i = _next++ ; i < _n ; i = _next++){
+            (*_fn)(worker, i);
+        }
+    }
+    void loop(size_t worker){
+        size_t seen = 0;
+        std::unique_lock<std::mutex> lock(_mutex);
+        while(true){
+            _start.wait(lock, [&]{ return _stop or _generation != seen; });
+            if(_stop) return;
+            seen = _generation;
+            lock.unlock();
+            work(worker);
+            lock.lock();
+            if(--_busy == 0) _done.notify_one();
+        }
+    }
+
+public:
+    // A pool of nThreads threads, the caller of run() included (workerCount() if 0).
+    explicit WorkerPool(size_t nThreads = 0){
+        if(!nThreads) nThreads = workerCount();
+        _threads.reserve(nThreads -1);
+        for(size_t t = 1 ; t < nThreads ; ++t){
+            _threads.emplace_back(&WorkerPool::loop, this, t);
+        }
+    }
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    ~WorkerPool(){
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _start.notify_all();
+        for(auto& th : _threads) th.join();
+    }
+
+    size_t size() const {
+        return _threads.size() +1;
+    }
+
+    // Run fn(worker, i) for every i in [0,n), worker in [0, size()).
+    template<typename F>
+    void run(size_t n, F fn){
+        if(_threads.empty() or n <= 1){
+            for(size_t i = 0 ; i < n ; ++i) fn(size_t(0), i);
+            return;
+        }
+        const std::function<void(size_t, size_t)> f = std::ref(fn);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _fn = &f;
+            _n = n;
+            _next = 0;
+            _busy = _threads.size();
+            ++_generation;
+        }
+        _start.notify_all();
+        work(0);
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait(lock, [&]{ return _busy == 0; });
+    }
+};
+
+#endif
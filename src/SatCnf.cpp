@@ -4,24 +4,30 @@
 #include <limits>
 #include <iostream>
 #include "prettyprint.hpp"
+#include "InputBuffer.h"
+#include "CnfCache.h"
 
 size_t SatCnf::parserLine;
 
 using namespace std;
 
-bool SatCnf::Literal::eval(SATvaluation val){
+bool SatCnf::Literal::eval(SATvaluation val) const {
     return val[var] ^ neg;
 }
 
-bool SatCnf::Clause::eval(SATvaluation val){
-    for(auto c : literals){
+bool SatCnf::Clause::eval(SATvaluation val) const {
+    return ClauseRef(*this).eval(val);
+}
+
+bool SatCnf::ClauseRef::eval(SATvaluation val) const {
+    for(const auto& c : literals){
         if(c(val)) return true;
     }
     return false;
 }
 
-bool SatCnf::eval(SATvaluation val){
-    for(auto c : clauses){
+bool SatCnf::eval(SATvaluation val) const {
+    for(const auto& c : clauses){
         if(!c(val)) return false;
     }
     return true;
@@ -84,12 +90,101 @@ SatCnf::SatCnf(std::istream& in){
     for(size_t i = 0 ; i < size ; ++i){
         Clause cl;
         in >> cl;
-        clauses.push_back(move(cl));
+        clauses.push_back(cl);
         ++ parserLine;
     }
 }
 
 
+namespace {
+// Read the comments and the p line of a DIMACS input : number of variables and of clauses.
+void readHeader(InputBuffer& in, int& numVar, int& size){
+    while(in.peek() == 'c'){
+        in.skipLine();
+        ++ SatCnf::parserLine;
+    }
+    if(in.peek() != 'p'){
+        throw SatCnf::SatSyntaxErr(SatCnf::parserLine, "Begin of line is not p or c before first p");
+    }
+    // reading p line
+    in.skip();
+    in.skipSpaces();
+    string s;
+    while(in.peek() >= 'a' and in.peek() <= 'z'){
+        s.push_back(in.peek());
+        in.skip();
+    }
+    numVar = 0;
+    size = 0;
+    in.skipSpaces();
+    bool ok = in.readInt(numVar);
+    in.skipSpaces();
+    ok = ok and in.readInt(size) and numVar >= 0 and size >= 0;
+    if(s.empty() or !ok) throw SatCnf::SatSyntaxErr(SatCnf::parserLine, "p line has wrong format");
+    if(s != "cnf") throw SatCnf::SatSyntaxErr(SatCnf::parserLine, "Only cnf format supported");
+    in.skipLine();
+    ++ SatCnf::parserLine;
+}
+
+// Read the line of a clause, giving each literal to add.
+template<typename Add>
+void readClause(InputBuffer& in, int numVar, Add add){
+    while(true){
+        in.skipSpaces();
+        int var;
+        if(!in.readInt(var)){
+            if(in.peek() == '\n' or in.peek() == EOF){
+                throw SatCnf::SatSyntaxErr(SatCnf::parserLine, "Clause does not end on 0");
+            }
+            throw SatCnf::SatSyntaxErr(SatCnf::parserLine, "Fail to read value of literal");
+        }
+        if(var == 0) break;
+        if(var > numVar or -var > numVar){
+            throw SatCnf::SatSyntaxErr(SatCnf::parserLine, "Variable out of range");
+        }
+        add(SatCnf::Literal{var < 0, (var < 0 ? -var : var) -1});
+    }
+    in.skipSpaces();
+    int c = in.peek();
+    if(c != '\n' and c != EOF){
+        throw SatCnf::SatSyntaxErr(SatCnf::parserLine, "Clause does not end on 0");
+    }
+    if(c == '\n') in.skip();
+    ++ SatCnf::parserLine;
+}
+}
+
+SatCnf::SatCnf(InputBuffer& in){
+    parserLine = 1;
+    if(in.peek() == (unsigned char)cacheFirstByte){
+        readCache(in, *this);
+        return;
+    }
+    int numVar, size;
+    readHeader(in, numVar, size);
+    _numVar = numVar;
+    clauses.reserve(size);
+    for(int i = 0 ; i < size ; ++i){
+        readClause(in, numVar, [this](Literal lit){ clauses.pushLiteral(lit); });
+        clauses.closeClause();
+    }
+}
+
+size_t SatCnf::stream(InputBuffer& in, const function<void(size_t)>& header,
+                      const function<bool(ClauseRef)>& out){
+    parserLine = 1;
+    int numVar, size;
+    readHeader(in, numVar, size);
+    header(numVar);
+    Clause cl;
+    for(int i = 0 ; i < size ; ++i){
+        cl.literals.clear();
+        readClause(in, numVar, [&cl](Literal lit){ cl.literals.push_back(lit); });
+        if(!out(cl)) return i+1;
+    }
+    return size;
+}
+
 SatCnf::SatCnf(int nVar) : _numVar(nVar){
 }
 
@@ -151,7 +246,7 @@ std::ostream& operator<<(std::ostream& out, const SatCnf::Literal& lit){
     out << lit.var+1;
     return out;
 }
-std::ostream& operator<<(std::ostream& out, const SatCnf::Clause& cl){
+std::ostream& operator<<(std::ostream& out, SatCnf::ClauseRef cl){
     for(const auto& lit : cl.literals){
         out << lit << " ";
     }
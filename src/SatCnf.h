@@ -1,27 +1,41 @@
 #ifndef SATCNF_H
 #define SATCNF_H
 
+#include <functional>
 #include <vector>
 #include <istream>
 #include <stdexcept>
 #include <string>
 #include <sstream>
+#include "ClausePool.h"
 
 
 using SATvaluation = const std::vector<bool>&;
 
+class InputBuffer;
+
 struct SatCnf{
     struct Literal{
         bool neg;
         int var;
-        bool eval(SATvaluation val);
-        bool operator()(SATvaluation val){return eval(val);}
+        bool eval(SATvaluation val) const;
+        bool operator()(SATvaluation val) const {return eval(val);}
     };
 
     struct Clause{
         std::vector<Literal> literals;
-        bool eval(SATvaluation val);
-        bool operator()(SATvaluation val){return eval(val);}
+        bool eval(SATvaluation val) const;
+        bool operator()(SATvaluation val) const {return eval(val);}
+    };
+
+    // Clause that is not owned : a clause of a SatCnf, or a Clause.
+    struct ClauseRef{
+        Span<const Literal> literals;
+        ClauseRef(Span<const Literal> lits) : literals(lits){}
+        ClauseRef(const Clause& cl)
+            : literals(cl.literals.data(), cl.literals.data() + cl.literals.size()){}
+        bool eval(SATvaluation val) const;
+        bool operator()(SATvaluation val) const {return eval(val);}
     };
 
     class SatSyntaxErr : public std::istream::failure{
@@ -39,18 +53,29 @@ struct SatCnf{
 
     static size_t parserLine;
     size_t _numVar;
-    std::vector<Clause> clauses;
+    ClausePool<Literal, ClauseRef> clauses;
     explicit SatCnf(std::istream& in);
+    // Same format and errors as above, read from a block or mapped input
+    // (a variable greater than the number of variables is also an error), or
+    // a binary cache (see CnfCache.h).
+    explicit SatCnf(InputBuffer& in);
+    // Read a DIMACS input clause by clause, for a consumer that does not wait for
+    // the whole formula : header gets the number of variables of the p line, then
+    // out gets each clause as soon as it is read, and can stop the reading by
+    // returning false. Return the number of clauses read. Same errors as above
+    // (a cache is not recognized).
+    static size_t stream(InputBuffer& in, const std::function<void(size_t)>& header,
+                         const std::function<bool(ClauseRef)>& out);
     explicit SatCnf(int nVar);
-    bool eval(SATvaluation val);
-    bool operator()(SATvaluation val){return eval(val);}
+    bool eval(SATvaluation val) const;
+    bool operator()(SATvaluation val) const {return eval(val);}
 };
 
 std::istream& operator>>(std::istream& in, SatCnf::Literal& lit);
 std::istream& operator>>(std::istream& in, SatCnf::Clause& cl);
 std::istream& operator>>(std::istream& in, SatCnf& SatCnf);
 std::ostream& operator<<(std::ostream& out, const SatCnf::Literal& lit);
-std::ostream& operator<<(std::ostream& out, const SatCnf::Clause& cl);
+std::ostream& operator<<(std::ostream& out, SatCnf::ClauseRef cl);
 std::ostream& operator<<(std::ostream& out, const SatCnf& Satcnf);
 
 
@@ -21,12 +21,20 @@ void SatSolver::checkInvariant(){
     Bitset value(_numVar);
     used.clear();
     value.clear();
-    for(auto& mlit : _model){
+    size_t level = 0;
+    for(size_t i = 0 ; i < _model.size() ; ++i){
+        auto& mlit = _model[i];
         // set used and value
         used[mlit.var.i] = true;
         value[mlit.var.i] = ! mlit.var.b;
-        // If decision literal stop here
-        if(&mlit.decidingCl == nullptr) continue;
+        // check the decision levels
+        if(mlit.isDecision()){
+            assert(level < _decisions.size() and _decisions[level] == i);
+            ++level;
+        }
+        assert(_level[mlit.var.i] == (int)level);
+        // If decision or theory literal stop here
+        if(mlit.isDecision() or &mlit.decidingCl == &_theoryReason) continue;
         // The deciding clause must be a set
         assert(isSet(mlit.decidingCl));
 
@@ -45,10 +53,16 @@ void SatSolver::checkInvariant(){
             }
         }
     }
+    assert(level == _decisions.size());
     assert(_used == used);
     for(size_t i= 0 ; i < _numVar ; ++i){
         if(used[i]){
             assert(_value[i] == value[i]);
+            assert(_litFalse[2*i] == !value[i]);
+            assert(_litFalse[2*i+1] == value[i]);
+        }
+        else{
+            assert(!_litFalse[2*i] and !_litFalse[2*i+1]);
         }
     }
 
@@ -62,22 +76,215 @@ void SatSolver::setVar(DInt var){
     }
     _used[var.i] = true;
     _value[var.i] = !var.b;
+    _level[var.i] = _decisions.size();
+    _litFalse[int(!var)] = 1;
+    if(_theory) _theory->assign(var.i, !var.b);
+}
+
+void SatSolver::unsetVar(int var){
+    assert(_used[var]);
+    _used[var] = false;
+    _phase[var] = bool(_value[var]);
+    _litFalse[2*var] = 0;
+    _litFalse[2*var+1] = 0;
+    if(_theory) _theory->unassign();
+}
+
+void SatSolver::backtrack(size_t size){
+    // the assumptions are checked again from the first one at the next decision.
+    if(_model.size() > size) _assumed = 0;
+    // backward, the theory undoes its assignments in reverse order.
+    while(_model.size() > size){
+        if(_model.back().isDecision()) _decisions.pop_back();
+        unsetVar(_model.back().var.i);
+        _model.pop_back();
+    }
+}
+
+void SatSolver::backjump(size_t level){
+    if(level >= _decisions.size()) return;
+    // the pending updates come from the current level, which is removed.
+    _toUpdate.clear();
+    backtrack(_decisions[level]);
+    if(_verbose){
+        cout << "Backjump to level " << level << endl << "New model : ";
+        printModel();
+        cout << endl;
+    }
+}
+
+void SatSolver::propagate(){
+    while(!_unsat){
+        if(theoryConflict()) continue;
+        if(!_toUpdate.empty()){
+            handle();
+            continue;
+        }
+        if(!theoryPropagate()) return;
+    }
+}
+
+bool SatSolver::theoryPropagate(){
+    if(!_theory) return false;
+    SatCnf::Literal lit;
+    while(_theory->propagate(lit)){
+        if(_used[lit.var]) continue;
+        DInt var(lit.neg, lit.var);
+        setVar(var);
+        _model.push_back(MLit(var, _theoryReason));
+        if(_verbose){
+            cout << "Theory propagation of " << var << endl << "New model : ";
+            printModel();
+            cout << endl;
+        }
+        return true;
+    }
+    return false;
+}
+
+vector<SatSolver::DInt> SatSolver::theoryExplain(DInt var){
+    SatCnf::Clause cl;
+    _theory->explain(SatCnf::Literal{var.b, var.i}, cl);
+    vector<DInt> res;
+    for(auto lit : cl.literals){
+        res.push_back(DInt(lit.neg, lit.var));
+    }
+    sort(res.begin(), res.end());
+    res.erase(unique(res.begin(), res.end()), res.end());
+    if(_verbose) cout << "Theory reason of " << var << " : " << res << endl;
+    return res;
+}
+
+bool SatSolver::theoryConflict(){
+    if(!_theory) return false;
+    SatCnf::Clause cl;
+    vector<SatCnf::Clause> defs;
+    if(!_theory->conflict(cl, defs)) return false;
+    for(auto& def : defs){
+        if(_verbose) cout << endl << "Theory definition : " << def << endl;
+        addClause(def, 0);
+    }
+    if(_verbose) cout << endl << "Theory conflict : " << cl << endl;
+    addClause(cl, 0);
+    return true;
+}
+
+int SatSolver::newVar(){
+    int var = _numVar++;
+    _used.resize(_numVar, false);
+    _value.resize(_numVar, false);
+    _phase.resize(_numVar, true);
+    _level.resize(_numVar, 0);
+    _litFalse.resize(2*_numVar + 4, 0);
+    _watched.resize(2*_numVar);
+    if(_ls) _ls->addVar();
+    return var;
+}
+
+bool SatSolver::ingest(bool wait){
+    while(true){
+        // read before taking the clauses : if it is set, they are the last ones.
+        bool closed = _queue->closed();
+        size_t n = _queue->take([this](SatCnf::ClauseRef cl){
+                for(const auto& lit : cl.literals){
+                    while(lit.var >= (int)_numVar) newVar();
+                }
+                addClause(cl, _scope);
+            });
+        if(_verbose and n > 0) cout << endl << "Ingested " << n << " clauses" << endl;
+        if(n > 0 or closed or !wait) return n > 0;
+        if(_interrupt and *_interrupt){
+            _unsat = true;
+            return false;
+        }
+        _queue->wait(_interrupt);
+    }
+}
+
+void SatSolver::setLocalSearch(bool enable){
+    if(enable) _ls.reset(new LocalSearch(_numVar));
+    else _ls.reset();
+}
+
+void SatSolver::localSearchPhases(){
+    for(; _lsClauses < _clauses.size() ; ++_lsClauses){
+        std::vector<int> lits;
+        for(DInt di : _clauses[_lsClauses].clause){
+            lits.push_back(int(di)); // same encoding as the local search : 2*var + neg
+        }
+        _ls->addClause(move(lits));
+    }
+    vector<bool> assign(_numVar);
+    for(size_t i = 0 ; i < _numVar ; ++i){
+        assign[i] = _phase[i];
+    }
+    bool found = _ls->run(assign, max<size_t>(100000, 20*_clauses.size()));
+    for(size_t i = 0 ; i < _numVar ; ++i){
+        _phase[i] = bool(assign[i]);
+    }
+    if(_verbose){
+        cout << endl << "Local search after " << _conflicts << " conflicts : "
+             << (found ? "model found" : "no model") << ", " << _ls->numUnsat()
+             << " false clauses" << endl;
+    }
+    _nextLocalSearch = _conflicts + _localSearchPeriod;
+    _localSearchPeriod *= 2;
 }
 
 bool SatSolver::decide(){
     checkInvariant();
     // we can't decide if their is still clauses to be updated.
     assert(_toUpdate.empty());
+    if(_interrupt and *_interrupt){
+        _unsat = true;
+        return true;
+    }
+    // the clauses of the producers are added between two propagations, where
+    // addClause can insert them in the model.
+    if(_queue and _queue->pending() and ingest(false)) return false;
+    if(_ls and _conflicts >= _nextLocalSearch) localSearchPhases();
+
+    // the assumptions are decided first, in order. Until they are all true, the
+    // decisions of the model are assumptions.
+    while(_assumed < _assumptions.size()){
+        DInt lit = _assumptions[_assumed];
+        if(isTrue(lit)){
+            ++_assumed;
+            continue;
+        }
+        if(isFalse(lit)){
+            failedAssumptions(lit);
+            return true;
+        }
+        _decisions.push_back(_model.size());
+        setVar(lit);
+        _model.push_back(MLit(lit,nullptr));
+        ++_assumed;
+        if(_verbose) {
+            cout << endl << "Assuming " << lit << endl << "New model : ";
+            printModel();
+            cout << endl;
+        }
+        return false;
+    }
 
     // first unaffected var.
     int var = _used.usf();
 
     // their is no unaffected vars :
-    if(var == -1) return true; // YEAH : SAT
+    if(var == -1){
+        // the model is only a solution if the producers have nothing more.
+        if(_queue and ingest(true)) return false;
+        return true; // YEAH : SAT
+    }
 
     assert(!_used[var]);
-    setVar(DInt(false,var));
-    _model.push_back(MLit(DInt(false,var),nullptr));
+    // the theory can choose the value instead of the saved phase.
+    int val = _theory ? _theory->phase(var) : -1;
+    DInt lit(val == -1 ? !_phase[var] : !val, var);
+    _decisions.push_back(_model.size());
+    setVar(lit);
+    _model.push_back(MLit(lit,nullptr));
     if(_verbose) {
         cout << endl << "Deciding var " << var+1 << endl << "New model : ";
         printModel();
@@ -100,9 +307,12 @@ void SatSolver::unit(DInt var, int clause){
 }
 
 SatSolver::SatSolver(int numVar, bool verbose)
-    : _numVar(numVar), _verbose(verbose), _used(numVar), _value(numVar){
+    : _numVar(numVar), _verbose(verbose), _used(numVar), _value(numVar), _phase(numVar),
+      _level(numVar, 0){
     _used.clear();
     _value.clear();
+    _phase.fill();
+    _litFalse.assign(2*numVar + 4, 0);
     _watched.resize(2*numVar);
 }
 
@@ -112,6 +322,7 @@ void SatSolver::conflict(int clause){ // Conflict by resolution then backjump
 
     // other clauses to be updated are useless when there is a conflict.
     _toUpdate.clear();
+    ++_conflicts;
     // new dynamic clauses on heap.
     vector<DInt>& R = *new std::vector<DInt>(_clauses[clause].clause);
     if(_verbose ) cout << endl <<endl << "Conflict on clause : " << R
@@ -123,7 +334,7 @@ void SatSolver::conflict(int clause){ // Conflict by resolution then backjump
         MLit& cur = _model.back();
         assert(!in(cur.var,R)); // the variable is not in R (R should always be a conflict).
         if(in(!cur.var,R)){ // If we are concerned by R.
-            if(&cur.decidingCl == nullptr){ // start backjump
+            if(cur.isDecision()){ // start backjump
                 if(_verbose){
                     cout << endl << "Conflict end on decision literal : " << cur.var
                          << " with clause : " << R << endl;
@@ -135,15 +346,13 @@ void SatSolver::conflict(int clause){ // Conflict by resolution then backjump
                         // If we found another variable in the model, we can't backjump past it.
                         break;
                     }
-                    if(&_model[i].decidingCl == nullptr) lastDeciLit = i;
+                    if(_model[i].isDecision()) lastDeciLit = i;
                 }
                 DInt v = cur.var;
                 v = !v;
-                for(size_t i = lastDeciLit ; i < _model.size() ; ++i){
-                    _used[_model[i].var.i] = false;
-                }
-                _model.resize(lastDeciLit);
-                unit(v,R);
+                backtrack(lastDeciLit);
+                if(R.size() <= maxLearnedSize) learn(R, v);
+                else unit(v,R);
 
                 if (_verbose){
                     cout << "New model : ";
@@ -155,13 +364,13 @@ void SatSolver::conflict(int clause){ // Conflict by resolution then backjump
                 return;
             }
             else{
-                fusion(R,cur.decidingCl);
+                if(&cur.decidingCl == &_theoryReason) fusion(R,theoryExplain(cur.var));
+                else fusion(R,cur.decidingCl);
 
                 if(_verbose) cout << endl << "Resolve on var : " << cur.var
                                   << " with new R : " << R << endl;
 
-                _used[_model.back().var.i] = false;
-                _model.pop_back();
+                backtrack(_model.size() -1);
 
                 if(_verbose) {
                     cout << "New model : ";
@@ -171,12 +380,54 @@ void SatSolver::conflict(int clause){ // Conflict by resolution then backjump
             }
         }
         else {// If we are not concerned by R, just pop back the model.
-            _used[_model.back().var.i] = false;
-            _model.pop_back();
+            backtrack(_model.size() -1);
         }
     }
-    cout << "-------------------UNSAT----------------------" << endl;
-    throw 0;
+    delete &R;
+    if(_verbose) cout << "-------------------UNSAT----------------------" << endl;
+    _unsat = true;
+}
+
+void SatSolver::failedAssumptions(DInt lit){
+    _failed.clear();
+    _failed.push_back(SatCnf::Literal{lit.b, lit.i});
+    vector<bool> seen(_numVar, false);
+    seen[lit.i] = true;
+    // as in conflict, the model is rewound so that the theory explains a literal
+    // with the model of its propagation.
+    while(!_model.empty()){
+        MLit& cur = _model.back();
+        if(seen[cur.var.i]){
+            if(cur.isDecision()){
+                _failed.push_back(SatCnf::Literal{cur.var.b, cur.var.i});
+            }
+            else if(&cur.decidingCl == &_theoryReason){
+                for(DInt di : theoryExplain(cur.var)) seen[di.i] = true;
+            }
+            else{
+                for(DInt di : cur.decidingCl) seen[di.i] = true;
+            }
+        }
+        backtrack(_model.size() -1);
+    }
+    if(_verbose) cout << "Failed assumptions : " << _failed << endl;
+}
+
+void SatSolver::learn(vector<DInt>& R, DInt v){
+    Clause cl{move(R), 0, 0, _scope};
+    delete &R;
+    // v is the only literal that is not false, the other watch is the false literal of highest level.
+    int best = -1;
+    for(size_t i = 0 ; i < cl.clause.size() ; ++i){
+        if(cl.clause[i] == v) cl.wl1 = i;
+        else if(best == -1 or _level[cl.clause[i].i] > _level[cl.clause[best].i]) best = i;
+    }
+    cl.wl2 = best == -1 ? cl.wl1 : best;
+    size_t c = _clauses.size();
+    _watched[cl.clause[cl.wl1]].insert(DInt(false,c));
+    _watched[cl.clause[cl.wl2]].insert(DInt(true,c));
+    _clauses.push_back(move(cl));
+    unit(v, c);
 }
 
 void SatSolver::handle(){
@@ -199,18 +450,16 @@ void SatSolver::handle(){
         // First case : the other watched literal is true.
         if(isTrue(cl.clause[cl.wl1])) return;
 
-        for(size_t i = 0 ; i < cl.clause.size() ; ++ i){
-            if (i == cl.wl1 or i == cl.wl2) continue;
-            if(!isFalse(cl.clause[i])){
-                // Second case, we can still watch another literal
-                if(_verbose) cout << "new watched literal found " << cl.clause[i]
-                                  << " at : " << i << endl;
+        size_t i = findNewWatch(cl);
+        if(i < cl.clause.size()){
+            // Second case, we can still watch another literal
+            if(_verbose) cout << "new watched literal found " << cl.clause[i]
+                              << " at : " << i << endl;
 
-                _watched[cl.clause[cl.wl2]].erase(clNum);
-                cl.wl2 = i;
-                _watched[cl.clause[cl.wl2]].insert(clNum);
-                return;
-            }
+            _watched[cl.clause[cl.wl2]].erase(clNum);
+            cl.wl2 = i;
+            _watched[cl.clause[cl.wl2]].insert(clNum);
+            return;
         }
 
         // third case we can't find other places and the other WL is false : conflict.
@@ -238,16 +487,14 @@ void SatSolver::handle(){
         }
         assert(isFalse(cl.clause[cl.wl1]));
         if(isTrue(cl.clause[cl.wl2])) return;
-        for(size_t i = 0 ; i < cl.clause.size() ; ++ i){
-            if (i == cl.wl1 or i == cl.wl2) continue;
-            if(!isFalse(cl.clause[i])){
-                if(_verbose) cout << "New watched literal found " << cl.clause[i]
-                                  << " at : " << i << endl;
-                _watched[cl.clause[cl.wl1]].erase(clNum);
-                cl.wl1 = i;
-                _watched[cl.clause[cl.wl1]].insert(clNum);
-                return;
-            }
+        size_t i = findNewWatch(cl);
+        if(i < cl.clause.size()){
+            if(_verbose) cout << "New watched literal found " << cl.clause[i]
+                              << " at : " << i << endl;
+            _watched[cl.clause[cl.wl1]].erase(clNum);
+            cl.wl1 = i;
+            _watched[cl.clause[cl.wl1]].insert(clNum);
+            return;
         }
         if(isFalse(cl.clause[cl.wl2])){
             conflict(clNum.i);
@@ -265,65 +512,153 @@ void SatSolver::handle(){
 
 void SatSolver::import(const SatCnf& sc){
     assert(sc._numVar == _numVar);
-    for(auto cl : sc.clauses){
+    for(const auto& cl : sc.clauses){
         addSMTConflict(cl);
     }
 }
 
-void SatSolver::addSMTConflict(SatCnf::Clause& cl){
+void SatSolver::addSMTConflict(SatCnf::ClauseRef cl){
+    addClause(cl, _scope);
+}
+
+void SatSolver::addClause(SatCnf::ClauseRef cl, unsigned scope){
     auto toDInt = [](SatCnf::Literal lit){ return DInt{lit.neg,lit.var};};
-    bool begin = _model.empty();
     if(cl.literals.size() == 0) return; // this clause is satisfiable
-    else{
-        Clause cl2;
-        for(auto lit : cl.literals){
-            cl2.clause.push_back(toDInt(lit));
-        }
-        sort(cl2.clause.begin(), cl2.clause.end());
-        if(begin){
-            cl2.wl1 = 0;
-            cl2.wl2 = cl.literals.size() -1;
-        }
-        else{
-            bool second = false;
-            for(int i = _model.size() -1 ; i >= 0 ; -- i){
-                if(in(!_model[i].var,cl2.clause)){
-                    if(!second){
-                        cl2.wl1 = index(!_model[i].var,cl2.clause);
-                        second = true;
-                    }
-                    else{
-                        cl2.wl2 = index(!_model[i].var,cl2.clause);
-                        break;
-                    }
-                }
+    Clause cl2;
+    cl2.clause.reserve(cl.literals.size());
+    for(auto lit : cl.literals){
+        cl2.clause.push_back(toDInt(lit));
+    }
+    sort(cl2.clause.begin(), cl2.clause.end());
+    // the clause must be a set, and a clause with x and ¬x is always true.
+    cl2.clause.erase(unique(cl2.clause.begin(), cl2.clause.end()), cl2.clause.end());
+    for(size_t i = 1 ; i < cl2.clause.size() ; ++i){
+        if(cl2.clause[i-1].i == cl2.clause[i].i) return;
+    }
+    size_t n = cl2.clause.size();
+    cl2.scope = scope;
+    cl2.wl1 = 0;
+    cl2.wl2 = n -1;
+    if(!_model.empty()){
+        // the literals that are not false first, then the false ones of highest level.
+        auto rank = [this](DInt lit){
+            return isFalse(lit) ? _level[lit.i] : int(_numVar) +1;
+        };
+        cl2.wl2 = (n > 1 ? 1 : 0);
+        if(rank(cl2.clause[1 % n]) > rank(cl2.clause[0])) swap(cl2.wl1, cl2.wl2);
+        for(size_t i = 2 ; i < n ; ++i){
+            int r = rank(cl2.clause[i]);
+            if(r > rank(cl2.clause[cl2.wl1])){
+                cl2.wl2 = cl2.wl1;
+                cl2.wl1 = i;
             }
+            else if(r > rank(cl2.clause[cl2.wl2])) cl2.wl2 = i;
         }
-        _watched[cl2.clause[cl2.wl1]].insert(DInt(false,_clauses.size()));
-        _watched[cl2.clause[cl2.wl2]].insert(DInt(true,_clauses.size()));
-        if(_verbose){
-            cout << "Creating clause " << _clauses.size() << " : " << cl2 << endl;
-            //printWatched();
-        }
-        _clauses.push_back(cl2);
     }
+    size_t c = _clauses.size();
+    _watched[cl2.clause[cl2.wl1]].insert(DInt(false,c));
+    _watched[cl2.clause[cl2.wl2]].insert(DInt(true,c));
+    if(_verbose){
+        cout << "Creating clause " << c << " : " << cl2 << endl;
+        //printWatched();
+    }
+    _clauses.push_back(move(cl2));
+    if(_model.empty()) return;
+
+    const Clause& added = _clauses[c];
+    DInt first = added.clause[added.wl1];
+    DInt second = added.clause[added.wl2];
+    // second is the first literal if the clause has only one.
+    bool alone = n == 1 or isFalse(second);
+    if(!isFalse(first)){
+        if(alone and !_used[first.i]) unit(first, c);
+        return;
+    }
+    // The clause is false.
+    int top = _level[first.i];
+    int assertLevel = n == 1 ? 0 : _level[second.i];
+    if(top == 0){ // false without any decision.
+        conflict(c);
+    }
+    else if(assertLevel < top){
+        // first is the only literal of its level : it is implied at the level of the others.
+        if(_verbose) cout << "Asserting clause " << c << endl;
+        backjump(assertLevel);
+        unit(first, c);
+    }
+    else{
+        backjump(top);
+        conflict(c);
+    }
+}
+
+std::vector<bool> SatSolver::solve(const std::vector<SatCnf::Literal>& assumptions){
+    vector<DInt> lits;
+    for(auto lit : assumptions){
+        lits.push_back(DInt(lit.neg, lit.var));
+    }
+    // the model of the previous call is valid if it had the same assumptions.
+    if(lits != _assumptions){
+        restart();
+        _assumptions = move(lits);
+        _assumed = 0;
+    }
+    return search();
+}
+
+void SatSolver::push(){
+    ++_scope;
+}
+
+void SatSolver::restart(){
+    _toUpdate.clear();
+    backtrack(0);
+}
+
+void SatSolver::pop(){
+    assert(_scope > 0);
+    // the reasons of the model may be removed clauses.
+    restart();
+    _unsat = false;
+    size_t j = 0;
+    for(size_t i = 0 ; i < _clauses.size() ; ++i){
+        if(_clauses[i].scope == _scope) continue;
+        if(i != j) _clauses[j] = move(_clauses[i]);
+        ++j;
+    }
+    _clauses.resize(j);
+    --_scope;
+    // the clauses are renumbered, any pair of literals is a valid watch without model.
+    for(auto& w : _watched) w.clear();
+    for(size_t c = 0 ; c < _clauses.size() ; ++c){
+        _watched[_clauses[c].clause[_clauses[c].wl1]].insert(DInt(false,c));
+        _watched[_clauses[c].clause[_clauses[c].wl2]].insert(DInt(true,c));
+    }
+    if(_ls){
+        _ls.reset(new LocalSearch(_numVar));
+        _lsClauses = 0;
+    }
+    if(_verbose) cout << "Pop : " << _clauses.size() << " clauses left" << endl;
 }
+
 std::vector<bool> SatSolver::solve(){
-    try{
-        if(!_model.empty()){
-            conflict(_clauses.size() -1);
-            goto middle;
-        }
-        while(!decide()){
-        middle:
-            while(!_toUpdate.empty()){
-                handle();
-            }
-        }
+    // the assumptions of a previous call don't hold anymore.
+    if(!_assumptions.empty()){
+        restart();
+        _assumptions.clear();
+        _assumed = 0;
     }
-    catch(int i){
-        return {};
+    return search();
+}
+
+std::vector<bool> SatSolver::search(){
+    _failed.clear();
+    propagate();
+    while(!_unsat and !decide()){
+        propagate();
     }
+    printLocalSearchStats();
+    if(_unsat or !_failed.empty()) return {};
 
     if(_verbose){
         cout << "SAT with model : ";
@@ -5,10 +5,16 @@
 #include <vector>
 #include <set>
 #include <deque>
+#include <atomic>
 #include <iostream>
 #include "SatCnf.h"
 #include "Bitset.h"
+#include "LocalSearch.h"
+#include "WatchScan.h"
+#include "SatTheory.h"
+#include "ClauseQueue.h"
 #include "prettyprint.hpp"
+#include <memory>
 
 // This class hold the sat solver state
 // The class invariants are programmatically stated in checkInvariant();
@@ -42,12 +48,16 @@ class SatSolver{
         DInt(bool nb, int ni) : b(nb), i(ni){}
         DInt(){assert(false);}
     };
+    static_assert(sizeof(DInt) == sizeof(int), "clauses are scanned as arrays of int");
 
     /*
       This struct represent a literal in the model.
 
       The variable is var (it can be negated).
-      if this is a decision literal then &decidingCl == nullptr;
+      if this is a decision literal then isDecision() is true (it is built with a
+      nullptr clause, and decidingCl is an empty clause);
+      if this is a theory propagation then &decidingCl == &_theoryReason (the
+      clause is asked to the theory only if needed);
       else decidingCl is the clause that lead to this decision.
       toDelete is designating if the clause must be deleted on literal destruction.
 
@@ -56,38 +66,83 @@ class SatSolver{
      */
     struct MLit{
         DInt var;
-        // if decision == {} : the var has been decided else this is the deciding clause.
+        // if decision : the var has been decided else this is the deciding clause.
         std::vector<DInt>& decidingCl; // sorted array
         bool toDelete = false;
-        MLit(DInt v, std::vector<DInt>* dCl) : var(v), decidingCl(*dCl), toDelete(true){}
+        bool decision = false;
+        MLit(DInt v, std::vector<DInt>* dCl) : var(v), decidingCl(dCl ? *dCl : noClause()),
+                                               toDelete(dCl != nullptr), decision(dCl == nullptr){}
         MLit(DInt v, std::vector<DInt>& dCl) : var(v), decidingCl(dCl), toDelete(false){}
-        MLit(MLit&& oth) : var(oth.var), decidingCl(oth.decidingCl), toDelete(oth.toDelete){
+        MLit(MLit&& oth) : var(oth.var), decidingCl(oth.decidingCl), toDelete(oth.toDelete),
+                           decision(oth.decision){
             oth.toDelete = false;
         }
         ~MLit(){
             if(toDelete) delete &decidingCl;
         }
         // HACK (this function is never used)
-        MLit() : decidingCl(*(std::vector<DInt>*)nullptr){assert(false);}
+        MLit() : decidingCl(noClause()){assert(false);}
+
+        bool isDecision() const {
+            return decision;
+        }
+        // The clause of the decisions, never modified.
+        static std::vector<DInt>& noClause(){
+            static std::vector<DInt> none;
+            return none;
+        }
     };
     // The number of variable
     size_t _numVar;
     // Enable verbose mode
     bool _verbose;
+    // If set by another thread, the search stops as if UNSAT.
+    const std::atomic<bool>* _interrupt = nullptr;
+    // Theory notified of the model changes and checked during the search.
+    SatTheory* _theory = nullptr;
+    // Clauses added by other threads during the search.
+    ClauseQueue* _queue = nullptr;
+    // Marker of the literals propagated by the theory, always empty.
+    std::vector<DInt> _theoryReason;
     // Current model M
     std::vector<MLit> _model;
     Bitset _used; // set of variable in the model;
     Bitset _value; // value of variable in the model, the value is undefined if not in the model.
+    Bitset _phase; // saved phase : value given to the variable when it is decided.
+    std::vector<int> _level; // decision level of each variable in the model.
+    std::vector<size_t> _decisions; // index in _model of each decision literal.
+    // Set when the search is over without model (UNSAT or interrupted).
+    bool _unsat = false;
+    // Literals decided before the other variables, and number of them known to be true.
+    std::vector<DInt> _assumptions;
+    size_t _assumed = 0;
+    // Assumptions that make the formula UNSAT, if the last solve failed because of them.
+    std::vector<SatCnf::Literal> _failed;
+    // Resolvents of at most this number of literals are kept as clauses, the longer
+    // ones only live as the reason of their literal.
+    static const size_t maxLearnedSize = 6;
+
+    // Local search used to seed _phase, if enabled.
+    std::unique_ptr<LocalSearch> _ls;
+    size_t _lsClauses = 0; // number of clauses already given to _ls.
+    size_t _conflicts = 0;
+    size_t _nextLocalSearch = 0; // value of _conflicts at which _ls is run again.
+    size_t _localSearchPeriod = 1000;
 
     // This is a solver clause with its 2 watching value.
     struct Clause{
         std::vector<DInt> clause;
         size_t wl1;
         size_t wl2;
+        // number of push() when the clause was added, it is removed by the pop() of this
+        // scope. The theory clauses are always true, their scope is 0.
+        unsigned scope;
     };
+    // number of push() without pop().
+    unsigned _scope = 0;
 
     // This is the list of clauses.
-    std::vector<Clause> _clauses;
+    std::deque<Clause> _clauses;
 
     // list of clause to be rechecked on setting a variable to false.
     // has size 2*_numVar and is indexed by the conversion to int of the literal DInt.
@@ -96,13 +151,29 @@ class SatSolver{
     std::deque<DInt> _toUpdate;
 
 
+    // One byte per literal (indexed by the conversion to int of the DInt) :
+    // 1 if the literal is false in the current model. It has 4 bytes of padding
+    // for the watch scan kernels (see WatchScan.h).
+    std::vector<u8> _litFalse;
+
     // Check if a var is true in the current model.
     bool isTrue(DInt var) const {
-        return _used[var.i] and (var.b ^ _value[var.i]);
+        return _litFalse[int(var) ^ 1];
     }
     // Check if a var is false in the current model.
     bool isFalse(DInt var) const {
-        return _used[var.i] and !(var.b ^ _value[var.i]);
+        return _litFalse[int(var)];
+    }
+
+    // Index of a literal of cl that is not false and not watched, or cl.clause.size().
+    size_t findNewWatch(const Clause& cl) const {
+        const int* lits = reinterpret_cast<const int*>(cl.clause.data());
+        size_t n = cl.clause.size();
+        size_t i = firstNonFalse(lits, 0, n, _litFalse.data());
+        while(i < n and (i == cl.wl1 or i == cl.wl2)){
+            i = firstNonFalse(lits, i+1, n, _litFalse.data());
+        }
+        return i;
     }
 
     // print the current model.
@@ -112,6 +183,13 @@ class SatSolver{
         }
     }
 
+    // print the throughput of the local search, if enabled.
+    void printLocalSearchStats() const {
+        if(!_ls) return;
+        std::cout << "Local search : " << _ls->flips() << " flips, "
+                  << _ls->flipsPerSecond() << " flips/s" << std::endl;
+    }
+
     // print the state of _watched.
     void printWatched() const {
         for(size_t i = 0 ; i < 2*_numVar ; ++ i){
@@ -157,13 +235,38 @@ class SatSolver{
 
     // rules
     void setVar(DInt var); // update all clauses with a var and _used and _value.
+    void unsetVar(int var); // remove var from _used and save its phase.
+    void backtrack(size_t size); // remove the literals of the model from index size, last first.
+    // Keep the model up to the end of this decision level, the pending updates are dropped.
+    void backjump(size_t level);
+    void localSearchPhases(); // run _ls from the saved phases and save its result.
     bool decide(); // decide a unaffected var : return false on decision, true if finished (SAT).
     // fix the value this var as non-decided and give an deletable reason.
     void unit(DInt var, std::vector<DInt>& decCl);
     // fix the value this var as non-decided and give an non-deletable reason.
     void unit(DInt var, int clause);
     void conflict(int clause); // resolve conflict on clause, do all resolution steps.
+    // Keep R as a clause and set v with it : v is its only literal that is not false.
+    void learn(std::vector<DInt>& R, DInt v);
+    // Search a model under the current assumptions.
+    std::vector<bool> search();
+
+    // The assumption lit is false : fill _failed with it and the assumptions that imply
+    // its negation (the decisions its reasons lead to). The model is emptied.
+    void failedAssumptions(DInt lit);
     void handle(); // take care of the next element in _toUpdate, fail badly if _toUpdate is empty.
+    void propagate(); // handle _toUpdate and the theory conflicts until there is nothing to do.
+    // If the theory has a conflict, add its clause and resolve it. Return true on conflict.
+    bool theoryConflict();
+    // Add a literal implied by the theory to the model. Return false if there is none.
+    bool theoryPropagate();
+    // Ask the theory the clause of a literal that it has propagated.
+    std::vector<DInt> theoryExplain(DInt var);
+    // addSMTConflict, with the scope of the clause.
+    void addClause(SatCnf::ClauseRef cl, unsigned scope);
+    // Add the clauses of _queue, creating their new variables. If wait is true,
+    // wait until there is one or the queue is closed. Return true if clauses were added.
+    bool ingest(bool wait);
 
     // Check class invariant
     void checkInvariant();
@@ -202,8 +305,58 @@ public :
     //Solve a sat Cnf, returns empty vector if UNSAT.
     std::vector<bool> solve();
 
-    // Add a SMT Conflict clause.
-    void addSMTConflict(SatCnf::Clause& cl);
+    // Solve with the assumptions decided first (they only hold for this call).
+    // The clauses learned by a call are kept by the next ones. Returns an empty
+    // vector if UNSAT : failed() then gives the assumptions that lead to it.
+    std::vector<bool> solve(const std::vector<SatCnf::Literal>& assumptions);
+
+    // Subset of the assumptions of the last solve that can't be all true (empty if the
+    // formula is UNSAT without them, or if the last solve found a model).
+    const std::vector<SatCnf::Literal>& failed() const {
+        return _failed;
+    }
+
+    // Add a clause, at any time (between solves or by a theory during the search).
+    // During a search, it watches its two literals of highest level (the ones that are
+    // not false first) : if it is false, the solver backjumps to its asserting level
+    // and sets its last literal (or resolves it if several literals have the highest level),
+    // if all its literals but one are false, this one is set.
+    void addSMTConflict(SatCnf::ClauseRef cl);
+
+    // Open a scope : the clauses added from now on (except the theory ones) are removed
+    // by the matching pop().
+    void push();
+    // Remove the clauses of the last scope. The model is emptied, the next solve
+    // starts from the saved phases, and a formula found UNSAT can be SAT again.
+    void pop();
+    // Empty the model, the next solve starts again from the saved phases.
+    void restart();
+
+    // Add a variable and return its index (the previous number of variables).
+    // It can be called at any time, also by a theory during the search.
+    int newVar();
+
+    // Run a local search periodically (on conflicts) to choose the value of decided variables.
+    void setLocalSearch(bool enable);
+
+    // Check the model against theory during the search. Must be set before solving.
+    void setTheory(SatTheory* theory){
+        assert(_model.empty());
+        _theory = theory;
+        _theory->newVar = [this]{ return newVar(); };
+    }
+
+    // Take the clauses of queue during the search, pushed by other threads : they are
+    // added as by addSMTConflict before each decision, and a complete model is only
+    // SAT once the queue is closed. UNSAT is the final answer as soon as it is found.
+    void setQueue(ClauseQueue* queue){
+        _queue = queue;
+    }
+
+    // Stop the search (solve returns UNSAT) as soon as *flag becomes true.
+    void setInterrupt(const std::atomic<bool>* flag){
+        _interrupt = flag;
+    }
 };
 
 inline std::ostream& operator<<(std::ostream& out, const SatSolver::DInt& var){
@@ -213,7 +366,7 @@ inline std::ostream& operator<<(std::ostream& out, const SatSolver::DInt& var){
 
 inline std::ostream& operator<<(std::ostream& out, const SatSolver::MLit& var){
     out << var.var;
-    if(&var.decidingCl != nullptr) out << var.decidingCl;
+    if(!var.isDecision()) out << var.decidingCl;
     return out;
 }
 
@@ -0,0 +1,56 @@
+#ifndef SATTHEORY_H
+#define SATTHEORY_H
+
+#include <functional>
+#include <vector>
+#include "SatCnf.h"
+
+/**
+   @brief Interface of a theory checked by SatSolver during the search.
+
+   The solver notifies every variable added to its model, and every removal.
+   Removals are always in the reverse order of the additions, so a theory can
+   undo its work with a simple log.
+
+   The theory can also give literals implied by the model : they are added to
+   the model like unit propagations, and their reason is only asked if it is
+   needed by a conflict.
+ */
+class SatTheory{
+public:
+    virtual ~SatTheory(){}
+
+    // var has been added to the model with value val.
+    virtual void assign(int var, bool val) = 0;
+
+    // The last variable given to assign has been removed from the model.
+    virtual void unassign() = 0;
+
+    // Create a fresh variable in the solver and return it, set by the solver.
+    std::function<int()> newVar;
+
+    // If the current assignment is inconsistent in the theory, fill cl with a
+    // clause that is false in the current model and return true.
+    // The theory may also define variables (usually fresh ones, from newVar) in
+    // defs : the last literal of each clause of defs is on a variable that is not
+    // assigned, the others are false. The solver adds them in order, setting their
+    // last literal, before cl (which can use these variables).
+    virtual bool conflict(SatCnf::Clause& cl, std::vector<SatCnf::Clause>& defs) = 0;
+
+    // If the current assignment implies a literal on a variable that is not
+    // assigned yet, put it in lit and return true.
+    virtual bool propagate(SatCnf::Literal& lit) = 0;
+
+    // lit has been given by propagate and is still in the model : fill cl with
+    // a clause that contains lit and whose other literals are false and were
+    // assigned before lit. It is only called when the solver needs it (on conflicts).
+    virtual void explain(SatCnf::Literal lit, SatCnf::Clause& cl) = 0;
+
+    // Value to give to var when the solver decides it : 1 (true), 0 (false), or
+    // -1 to keep the saved phase of the solver.
+    virtual int phase(int /*var*/){
+        return -1;
+    }
+};
+
+#endif
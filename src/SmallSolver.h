@@ -0,0 +1,211 @@
+#ifndef SMALLSOLVER_H
+#define SMALLSOLVER_H
+
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "SatCnf.h"
+#include "Bitset.h"
+#include "prettyprint.hpp"
+
+using u128 = unsigned __int128;
+
+// Index of the lowest set bit of a non-zero word.
+inline int lowBit(u64 w){
+    return __builtin_ctzll(w);
+}
+inline int lowBit(u128 w){
+    u64 low = u64(w);
+    return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll(u64(w >> 64));
+}
+
+// Does w have at least 2 bits set ?
+template<typename Word>
+inline bool severalBits(Word w){
+    return w & (w - 1);
+}
+
+/**
+   @brief SAT solver for formulas with at most 8*sizeof(Word) variables.
+
+   Each clause is a pair of masks (positive and negative variables) and the model is
+   a pair of masks (assigned variables and their values), so checking a clause
+   is a few word-wide and/or. Conflict analysis works on masks of variables too :
+   all the literals of a conflict clause are false, so the learned clause is
+   fully described by its set of variables.
+
+   The search is a CDCL : first UIP learning, backjumping and saved phases.
+   The trail, levels, reasons and the assigned mask at each level are arrays on the
+   C++ stack : the only allocation is the clause array.
+
+   It has the same interface as SatSolver so that the SMT loop can use both.
+ */
+template<typename Word>
+class SmallSolver{
+    struct Clause{
+        Word pos;
+        Word neg;
+        Word vars() const {
+            return pos | neg;
+        }
+    };
+    static constexpr size_t maxVar = 8 * sizeof(Word);
+
+    size_t _numVar;
+    bool _verbose;
+    Word _all; // mask of all variables
+    std::vector<Clause> _clauses;
+    const std::atomic<bool>* _interrupt = nullptr;
+
+    static Word bit(int var){
+        return Word(1) << var;
+    }
+
+    // The search state, it only lives during solve().
+    struct State{
+        Word assigned = 0;
+        Word val; // value of assigned variables, saved phase of the others.
+        size_t depth = 0; // decision level
+        int trail[maxVar];
+        size_t trailSize = 0;
+        int level[maxVar];
+        int reason[maxVar]; // index of the clause, -1 for decisions
+        // assigned mask and trail size at the beginning of each level.
+        Word levelAssigned[maxVar + 1];
+        size_t levelTrail[maxVar + 1];
+
+        void assign(int var, bool value, int why){
+            assigned |= bit(var);
+            if(value) val |= bit(var);
+            else val &= ~bit(var);
+            level[var] = depth;
+            reason[var] = why;
+            trail[trailSize++] = var;
+        }
+    };
+
+    // Unit propagation until fixpoint, returns the index of a false clause or -1.
+    // Only the clauses with a variable of touched (assigned since the last call) can have changed.
+    int propagate(State& st, Word touched) const {
+        while(touched){
+            Word before = st.assigned;
+            for(size_t i = 0 ; i < _clauses.size() ; ++i){
+                const Clause& cl = _clauses[i];
+                if(!(cl.vars() & touched)) continue;
+                if((cl.pos & st.assigned & st.val) | (cl.neg & st.assigned & ~st.val)) continue; // true
+                Word free = cl.vars() & ~st.assigned;
+                if(!free) return i; // all literals are false
+                if(severalBits(free)) continue;
+                st.assign(lowBit(free), cl.pos & free, i);
+            }
+            touched = st.assigned & ~before;
+        }
+        return -1;
+    }
+
+    // Learn a clause from the false clause conflict, backjump and assert it.
+    // Returns the mask of the asserted variable.
+    Word analyze(State& st, int conflict){
+        Word cur = st.assigned & ~st.levelAssigned[st.depth];
+        Word learned = _clauses[conflict].vars();
+        // resolve on the variables of the current level, from the last assigned,
+        // until only one is left (first UIP).
+        size_t t = st.trailSize;
+        while(severalBits(learned & cur)){
+            int v;
+            do{
+                v = st.trail[--t];
+            } while(!(learned & bit(v)));
+            assert(st.reason[v] != -1);
+            learned = (learned | _clauses[st.reason[v]].vars()) & ~bit(v);
+        }
+        int uip = lowBit(learned & cur);
+        size_t back = 0;
+        for(Word m = learned & ~bit(uip) ; m ; m &= m - 1){
+            back = std::max<size_t>(back, st.level[lowBit(m)]);
+        }
+        // all these literals are false.
+        _clauses.push_back(Clause{learned & ~st.val, learned & st.val});
+        if(_verbose){
+            std::cout << "Small solver conflict : UIP " << uip+1
+                      << ", backjump to level " << back << std::endl;
+        }
+
+        st.depth = back;
+        st.assigned = st.levelAssigned[back +1];
+        st.trailSize = st.levelTrail[back +1];
+        st.assign(uip, !((st.val >> uip) & 1), _clauses.size() -1);
+        return bit(uip);
+    }
+
+public:
+    SmallSolver(int numVar, bool verbose) : _numVar(numVar), _verbose(verbose){
+        assert(_numVar <= maxVar);
+        _all = _numVar == maxVar ? ~Word(0) : bit(_numVar) - 1;
+    }
+
+    // Import SatCnf into the solver.
+    void import(const SatCnf& sc){
+        assert(sc._numVar == _numVar);
+        for(const auto& cl : sc.clauses){
+            addSMTConflict(cl);
+        }
+    }
+
+    // Add a clause, the next solve takes it into account.
+    void addSMTConflict(SatCnf::ClauseRef cl){
+        Clause c{0, 0};
+        for(const auto& lit : cl.literals){
+            (lit.neg ? c.neg : c.pos) |= bit(lit.var);
+        }
+        if(c.pos & c.neg) return; // x v ¬x is always true.
+        if(!c.vars()) return; // empty clauses are ignored, like in SatSolver.
+        _clauses.push_back(c);
+    }
+
+    // Stop the search (solve returns UNSAT) as soon as *flag becomes true.
+    void setInterrupt(const std::atomic<bool>* flag){
+        _interrupt = flag;
+    }
+
+    //Solve the formula, returns empty vector if UNSAT.
+    std::vector<bool> solve(){
+        State st;
+        st.val = ~Word(0); // decide true first, like SatSolver.
+        st.levelAssigned[0] = 0;
+        st.levelTrail[0] = 0;
+        Word touched = _all;
+        while(true){
+            int conflict = propagate(st, touched);
+            if(conflict != -1){
+                if(st.depth == 0){
+                    if(_verbose) std::cout << "-------------------UNSAT----------------------" << std::endl;
+                    return {};
+                }
+                touched = analyze(st, conflict);
+                continue;
+            }
+            if(_interrupt and *_interrupt) return {};
+            Word free = _all & ~st.assigned;
+            if(!free) break; // SAT
+            int var = lowBit(free);
+            ++st.depth;
+            st.levelAssigned[st.depth] = st.assigned;
+            st.levelTrail[st.depth] = st.trailSize;
+            if(_verbose) std::cout << "Small solver deciding var " << var+1 << std::endl;
+            st.assign(var, (st.val >> var) & 1, -1);
+            touched = bit(var);
+        }
+
+        std::vector<bool> res(_numVar);
+        for(size_t i = 0 ; i < _numVar ; ++i){
+            res[i] = (st.val >> i) & 1;
+        }
+        if(_verbose) std::cout << "SAT with model : " << res << std::endl;
+        return res;
+    }
+};
+
+#endif
@@ -3,12 +3,31 @@
 #include <istream>
 #include <limits>
 #include <iostream>
+#include <map>
+#include "InputBuffer.h"
+#include "CnfCache.h"
 
 using namespace std;
 
 size_t SmtCnf::parserLine;
+SmtCnf* SmtCnf::parserCnf = nullptr;
 
-bool SmtCnf::Literal::eval(SMTvaluation val){
+// parser state : number of variables of the p line, and index of each application already read.
+static int parserNumVar = 0;
+static map<pair<int, vector<int>>, int> parserApps;
+
+// Term of the application fun(args) in parserCnf, added if it is new.
+static int appTerm(int fun, vector<int>& args){
+    auto key = make_pair(fun, args);
+    auto it = parserApps.find(key);
+    if(it != parserApps.end()) return it->second;
+    int term = SmtCnf::parserCnf->_numVar++;
+    parserApps.insert(make_pair(move(key), term));
+    SmtCnf::parserCnf->apps.push_back(SmtCnf::App{fun, move(args), term});
+    return term;
+}
+
+bool SmtCnf::Literal::eval(SMTvaluation val) const {
     switch(type){
         case EQUAL:
             return val[var1] == val[var2];
@@ -19,20 +38,108 @@ bool SmtCnf::Literal::eval(SMTvaluation val){
     assert(false);
 }
 
-bool SmtCnf::Clause::eval(SMTvaluation val){
-    for(auto c : literals){
+bool SmtCnf::Clause::eval(SMTvaluation val) const {
+    return ClauseRef(*this).eval(val);
+}
+
+bool SmtCnf::ClauseRef::eval(SMTvaluation val) const {
+    for(const auto& c : literals){
         if(c(val)) return true;
     }
     return false;
 }
 
-bool SmtCnf::eval(SMTvaluation val){
-    for(auto c : clauses){
+bool SmtCnf::eval(SMTvaluation val) const {
+    for(const auto& c : clauses){
         if(!c(val)) return false;
     }
+    // the applications with equal arguments must be equal.
+    map<pair<int, vector<int>>, int> values;
+    for(const auto& app : apps){
+        vector<int> args;
+        for(int a : app.args) args.push_back(val[a]);
+        auto it = values.insert(make_pair(make_pair(app.fun, move(args)), val[app.term])).first;
+        if(it->second != val[app.term]) return false;
+    }
     return true;
 }
 
+int SmtCnf::readTerm(std::istream& in){
+    while(in.peek() == ' '){
+        in.ignore();
+    }
+    if(in.peek() != 'f'){
+        int var;
+        try{
+            in >> var;
+        }
+        catch (istream::failure& e){
+            throw SmtSyntaxErr(parserLine, "Fail to read variable");
+        }
+        if(parserCnf and (var < 1 or var > parserNumVar)){
+            throw SmtSyntaxErr(parserLine, "Variable out of range");
+        }
+        return var -1;
+    }
+    if(!parserCnf) throw SmtSyntaxErr(parserLine, "Function application outside of a formula");
+    in.ignore(1);
+    int fun;
+    try{
+        in >> fun;
+        if(in.get() != '(') in.setstate(istream::failbit);
+    }
+    catch (istream::failure& e){
+        throw SmtSyntaxErr(parserLine, "Function application must be f<id>(arguments)");
+    }
+    vector<int> args;
+    while(true){
+        args.push_back(readTerm(in));
+        try{
+            while(in.peek() == ' '){
+                in.ignore();
+            }
+            char c = in.get();
+            if(c == ')') break;
+            if(c != ',') in.setstate(istream::failbit);
+        }
+        catch (istream::failure& e){
+            throw SmtSyntaxErr(parserLine, "Arguments must be separated by , and end by )");
+        }
+    }
+    return appTerm(fun, args);
+}
+
+int SmtCnf::readTerm(InputBuffer& in){
+    in.skipSpaces();
+    if(in.peek() != 'f'){
+        int var;
+        if(!in.readInt(var)) throw SmtSyntaxErr(parserLine, "Fail to read variable");
+        if(parserCnf and (var < 1 or var > parserNumVar)){
+            throw SmtSyntaxErr(parserLine, "Variable out of range");
+        }
+        return var -1;
+    }
+    if(!parserCnf) throw SmtSyntaxErr(parserLine, "Function application outside of a formula");
+    in.skip();
+    int fun;
+    if(!in.readInt(fun) or in.peek() != '('){
+        throw SmtSyntaxErr(parserLine, "Function application must be f<id>(arguments)");
+    }
+    in.skip();
+    vector<int> args;
+    while(true){
+        args.push_back(readTerm(in));
+        in.skipSpaces();
+        int c = in.peek();
+        if(c != ')' and c != ','){
+            throw SmtSyntaxErr(parserLine, "Arguments must be separated by , and end by )");
+        }
+        in.skip();
+        if(c == ')') break;
+    }
+    return appTerm(fun, args);
+}
+
 
 
 
@@ -90,25 +197,100 @@ SmtCnf::SmtCnf(std::istream& in){
 
     clauses.reserve(size);
     ++parserLine;
-    for(size_t i = 0 ; i < size ; ++i){
-        Clause cl;
-        in >> cl;
-        clauses.push_back(move(cl));
-        ++ parserLine;
+    parserCnf = this;
+    parserNumVar = _numVar;
+    parserApps.clear();
+    try{
+        for(size_t i = 0 ; i < size ; ++i){
+            Clause cl;
+            in >> cl;
+            clauses.push_back(cl);
+            ++ parserLine;
+        }
     }
+    catch(...){
+        parserCnf = nullptr;
+        throw;
+    }
+    parserCnf = nullptr;
+    parserApps.clear();
 }
 
+SmtCnf::SmtCnf(InputBuffer& in){
+    parserLine = 1;
+    if(in.peek() == (unsigned char)cacheFirstByte){
+        readCache(in, *this);
+        return;
+    }
+    while(in.peek() == 'c'){
+        in.skipLine();
+        ++ parserLine;
+    }
+    if(in.peek() != 'p'){
+        throw SmtSyntaxErr(parserLine, "Begin of line is not p or c before first p");
+    }
+    // reading p line
+    in.skip();
+    in.skipSpaces();
+    string s;
+    while(in.peek() >= 'a' and in.peek() <= 'z'){
+        s.push_back(in.peek());
+        in.skip();
+    }
+    int size;
+    in.skipSpaces();
+    bool ok = in.readInt(_numVar);
+    in.skipSpaces();
+    ok = ok and in.readInt(size) and _numVar >= 0 and size >= 0;
+    if(s.empty() or !ok) throw SmtSyntaxErr(parserLine, "p line has wrong format");
+    if(s != "cnf") throw SmtSyntaxErr(parserLine, "Only cnf format supported");
+    in.skipLine();
 
-
-std::istream& operator>>(std::istream& in, SmtCnf::Literal& lit){
+    clauses.reserve(size);
+    ++parserLine;
+    parserCnf = this;
+    parserNumVar = _numVar;
+    parserApps.clear();
     try{
-        in >> lit.var1;
-        lit.var1 -= 1;
+        // as above, the missing lines are empty clauses.
+        for(int i = 0 ; i < size ; ++i){
+            in.skipSpaces();
+            while(in.peek() != '\n' and in.peek() != EOF){
+                Literal lit;
+                lit.var1 = readTerm(in);
+                int c = in.peek();
+                in.skip();
+                if(c == '=') lit.type = Literal::EQUAL;
+                else if(c == '<' and in.peek() == '>'){
+                    in.skip();
+                    lit.type = Literal::NOTEQ;
+                }
+                else{
+                    throw SmtSyntaxErr(parserLine, "Comparison symbol invalid while reading literal");
+                }
+                lit.var2 = readTerm(in);
+                clauses.pushLiteral(lit);
+                in.skipSpaces();
+            }
+            if(in.peek() == '\n') in.skip();
+            clauses.closeClause();
+            ++ parserLine;
+        }
     }
-    catch (istream::failure& e){
-        throw SmtCnf::SmtSyntaxErr(SmtCnf::parserLine,
-                                   "Fail to read first variable of literal");
+    catch(...){
+        parserCnf = nullptr;
+        throw;
     }
+    parserCnf = nullptr;
+    parserApps.clear();
+}
+
+SmtCnf::SmtCnf(int nVar) : _numVar(nVar){
+}
+
+
+std::istream& operator>>(std::istream& in, SmtCnf::Literal& lit){
+    lit.var1 = SmtCnf::readTerm(in);
 
     try{
         switch (in.peek()){
@@ -130,14 +312,7 @@ std::istream& operator>>(std::istream& in, SmtCnf::Literal& lit){
                                    "Comparison symbol invalid while reading literal");
     }
 
-    try{
-        in >> lit.var2;
-        lit.var2 -= 1;
-    }
-    catch (istream::failure& e){
-        throw SmtCnf::SmtSyntaxErr(SmtCnf::parserLine,
-                                   "Fail to read second variable of literal");
-    }
+    lit.var2 = SmtCnf::readTerm(in);
 
     return in;
 }
@@ -181,7 +356,7 @@ std::ostream& operator<<(std::ostream& out, const SmtCnf::Literal& lit){
     out << " " << lit.var2+1;
     return out;
 }
-std::ostream& operator<<(std::ostream& out, const SmtCnf::Clause& cl){
+std::ostream& operator<<(std::ostream& out, SmtCnf::ClauseRef cl){
     for(const auto& lit : cl.literals){
         out << lit << "  ";
     }
@@ -190,6 +365,13 @@ std::ostream& operator<<(std::ostream& out, const SmtCnf::Clause& cl){
 }
 std::ostream& operator<<(std::ostream& out, const SmtCnf& Smtcnf){
     out << "cnf " << Smtcnf._numVar << " " << Smtcnf.clauses.size() << endl;
+    for(const auto& app : Smtcnf.apps){
+        out << app.term+1 << " := f" << app.fun << "(";
+        for(size_t i = 0 ; i < app.args.size() ; ++i){
+            out << (i ? ", " : "") << app.args[i]+1;
+        }
+        out << ")" << endl;
+    }
     for(const auto& cl : Smtcnf.clauses){
         out << cl;
     }
@@ -6,9 +6,12 @@
 #include <stdexcept>
 #include <string>
 #include <sstream>
+#include "ClausePool.h"
 
 using SMTvaluation = const std::vector<int>&;
 
+class InputBuffer;
+
 struct SmtCnf{
     struct Literal{
         enum Type{
@@ -17,14 +20,31 @@ struct SmtCnf{
         Type type;
         int var1;
         int var2;
-        bool eval(SMTvaluation val);
-        bool operator()(SMTvaluation val){return eval(val);}
+        bool eval(SMTvaluation val) const;
+        bool operator()(SMTvaluation val) const {return eval(val);}
     };
 
     struct Clause{
         std::vector<Literal> literals;
-        bool eval(SMTvaluation val);
-        bool operator()(SMTvaluation val){return eval(val);}
+        bool eval(SMTvaluation val) const;
+        bool operator()(SMTvaluation val) const {return eval(val);}
+    };
+
+    // Clause that is not owned : a clause of a SmtCnf, or a Clause.
+    struct ClauseRef{
+        Span<const Literal> literals;
+        ClauseRef(Span<const Literal> lits) : literals(lits){}
+        ClauseRef(const Clause& cl)
+            : literals(cl.literals.data(), cl.literals.data() + cl.literals.size()){}
+        bool eval(SMTvaluation val) const;
+        bool operator()(SMTvaluation val) const {return eval(val);}
+    };
+
+    // Application of an uninterpreted function : the value of term is fun(args).
+    struct App{
+        int fun;
+        std::vector<int> args;
+        int term;
     };
 
     class SmtSyntaxErr : public std::istream::failure{
@@ -40,18 +60,29 @@ struct SmtCnf{
     };
 
     static size_t parserLine;
+    // Formula being read : the applications of its literals are added to it.
+    static SmtCnf* parserCnf;
+    // Number of terms : the variables, then the applications.
     int _numVar;
-    std::vector<Clause> clauses;
+    ClausePool<Literal, ClauseRef> clauses;
+    std::vector<App> apps;
+    // Read a term, a variable or f<id>(term, ..., term), and return its index.
+    static int readTerm(std::istream& in);
+    static int readTerm(InputBuffer& in);
     explicit SmtCnf(std::istream& in);
-    bool eval(SMTvaluation val);
-    bool operator()(SMTvaluation val){return eval(val);}
+    // Same format and errors as above, read from a block or mapped input, or
+    // a binary cache (see CnfCache.h).
+    explicit SmtCnf(InputBuffer& in);
+    explicit SmtCnf(int nVar);
+    bool eval(SMTvaluation val) const;
+    bool operator()(SMTvaluation val) const {return eval(val);}
 };
 
 std::istream& operator>>(std::istream& in, SmtCnf::Literal& lit);
 std::istream& operator>>(std::istream& in, SmtCnf::Clause& cl);
 std::istream& operator>>(std::istream& in, SmtCnf& SmtCnf);
 std::ostream& operator<<(std::ostream& out, const SmtCnf::Literal& lit);
-std::ostream& operator<<(std::ostream& out, const SmtCnf::Clause& cl);
+std::ostream& operator<<(std::ostream& out, SmtCnf::ClauseRef cl);
 std::ostream& operator<<(std::ostream& out, const SmtCnf& SmtCnf);
 
 
@@ -0,0 +1,94 @@
+#include "SmtIncremental.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+SmtIncremental::SmtIncremental(bool smtVerbose, bool satVerbose)
+    : _ss(0, satVerbose), _theory(_ker, smtVerbose), _false(1, false){
+    // all the atoms are created by the theory, as its fresh ones.
+    _ker.buildGraph();
+    _ss.setTheory(&_theory);
+}
+
+int SmtIncremental::newVar(){
+    _vertex.push_back(_theory.addTerm());
+    return _vertex.size() -1;
+}
+
+int SmtIncremental::app(int fun, const vector<int>& args){
+    auto key = make_pair(fun, args);
+    auto it = _apps.find(key);
+    if(it != _apps.end()) return it->second;
+    int term = newVar();
+    _apps.insert(make_pair(move(key), term));
+    SmtCnf::App vapp{fun, {}, _vertex[term]};
+    for(int a : args) vapp.args.push_back(_vertex[a]);
+    // the congruences of the new application must not depend on the model.
+    _ss.restart();
+    _theory.addApp(vapp);
+    return term;
+}
+
+void SmtIncremental::assertClause(SmtCnf::ClauseRef cl){
+    if(cl.literals.empty()){
+        _false.back() = true;
+        return;
+    }
+    SatCnf::Clause scl;
+    for(const auto& lit : cl.literals){
+        int atom = _theory.addAtom(_vertex[lit.var1], _vertex[lit.var2]);
+        scl.literals.push_back(SatCnf::Literal{lit.type == SmtCnf::Literal::NOTEQ, atom});
+    }
+    _ss.addSMTConflict(scl);
+}
+
+void SmtIncremental::assertFormula(const SmtCnf& sc, vector<int>& terms){
+    terms.resize(sc._numVar, -1);
+    vector<bool> isApp(sc._numVar, false);
+    for(const auto& a : sc.apps) isApp[a.term] = true;
+    for(int v = 0 ; v < sc._numVar ; ++v){
+        if(!isApp[v] and terms[v] == -1) terms[v] = newVar();
+    }
+    // the arguments of an application are read before it.
+    for(const auto& a : sc.apps){
+        vector<int> args;
+        for(int arg : a.args) args.push_back(terms[arg]);
+        terms[a.term] = app(a.fun, args);
+    }
+    for(const auto& cl : sc.clauses){
+        SmtCnf::Clause tcl;
+        for(auto lit : cl.literals){
+            lit.var1 = terms[lit.var1];
+            lit.var2 = terms[lit.var2];
+            tcl.literals.push_back(lit);
+        }
+        assertClause(tcl);
+    }
+}
+
+void SmtIncremental::push(){
+    _false.push_back(false);
+    _ss.push();
+}
+
+void SmtIncremental::pop(){
+    assert(depth() > 0);
+    _false.pop_back();
+    _ss.pop();
+}
+
+bool SmtIncremental::check(){
+    if(find(_false.begin(), _false.end(), true) != _false.end()) return false;
+    // without any atom the solver has no variable : its empty model is not UNSAT.
+    if(_ker.from.empty()) return true;
+    return !_ss.solve().empty();
+}
+
+vector<int> SmtIncremental::model() const {
+    vector<int> res(_vertex.size());
+    for(size_t t = 0 ; t < _vertex.size() ; ++t){
+        res[t] = _theory.root(_vertex[t]);
+    }
+    return res;
+}
@@ -0,0 +1,73 @@
+#ifndef SMTINCREMENTAL_H
+#define SMTINCREMENTAL_H
+
+#include <map>
+#include <utility>
+#include <vector>
+#include "SmtCnf.h"
+#include "SmtSolver.h"
+#include "SatSolver.h"
+#include "EqTheory.h"
+
+/**
+   @brief SMT solver for a sequence of related queries : clauses are asserted in
+   scopes, and each check reuses the work of the previous ones.
+
+   There is one SatSolver and one online EqTheory for the whole sequence. The
+   terms, atoms and function applications are created on first use and kept
+   until the end, even when the clauses that use them are popped. The theory
+   lemmas (conflict clauses and definitions of fresh atoms) are true in every
+   scope, so they are kept too. pop() only removes the asserted clauses of the
+   scope, and the next check starts again from the saved phases of the solver.
+
+   After a check, a new clause is added to the current model of the solver
+   (see SatSolver::addSMTConflict) : a check after an assertion only redoes the
+   part of the search it invalidates.
+ */
+class SmtIncremental{
+    SmtSatKernel _ker;
+    SatSolver _ss;
+    EqTheory _theory;
+    // vertex of the theory of each term.
+    std::vector<int> _vertex;
+    // term of each application (function, arguments).
+    std::map<std::pair<int, std::vector<int>>, int> _apps;
+    // an empty clause has been asserted in each open scope (the first one is the base).
+    std::vector<bool> _false;
+
+public:
+    explicit SmtIncremental(bool smtVerbose = false, bool satVerbose = false);
+    SmtIncremental(const SmtIncremental&) = delete;
+    SmtIncremental& operator=(const SmtIncremental&) = delete;
+
+    // Add a term (a variable) and return its index.
+    int newVar();
+    // Term fun(args), created if it does not exist yet.
+    int app(int fun, const std::vector<int>& args);
+    // Number of terms, the variables and the applications.
+    int numTerms() const {
+        return _vertex.size();
+    }
+
+    // Assert a clause on terms in the current scope. An empty clause is false.
+    void assertClause(SmtCnf::ClauseRef cl);
+    // Assert the clauses of sc : terms[v] is the term of the variable v of sc, the
+    // missing ones are created and the terms of the applications are set.
+    void assertFormula(const SmtCnf& sc, std::vector<int>& terms);
+
+    // Open a scope.
+    void push();
+    // Remove the clauses asserted since the matching push.
+    void pop();
+    // Number of open scopes.
+    size_t depth() const {
+        return _false.size() -1;
+    }
+
+    // Return true if the asserted clauses are satisfiable.
+    bool check();
+    // Class of each term, after a check that returned true and before any other change.
+    std::vector<int> model() const;
+};
+
+#endif
@@ -0,0 +1,537 @@
+#include "SmtLib.h"
+#include <cstring>
+#include "InputBuffer.h"
+
+using namespace std;
+
+namespace {
+// tokens that are not symbols.
+const int LPAR = -1;
+const int RPAR = -2;
+const int STRING = -3;
+
+// symbols interned first, so that their id is their index.
+enum Symbol{
+    SYM_TRUE, SYM_FALSE, SYM_NOT, SYM_AND, SYM_OR, SYM_XOR, SYM_IMPLIES, SYM_EQ,
+    SYM_DISTINCT, SYM_ITE, SYM_LET, SYM_BANG, SYM_BOOL,
+    SYM_SET_LOGIC, SYM_SET_INFO, SYM_SET_OPTION, SYM_DECLARE_SORT, SYM_DECLARE_FUN,
+    SYM_DECLARE_CONST, SYM_DEFINE_FUN, SYM_ASSERT, SYM_CHECK_SAT, SYM_PUSH, SYM_POP,
+    SYM_EXIT, SYM_PRINT_SUCCESS, NUM_SYMBOLS
+};
+const char* symbolNames[NUM_SYMBOLS] = {
+    "true", "false", "not", "and", "or", "xor", "=>", "=",
+    "distinct", "ite", "let", "!", "Bool",
+    "set-logic", "set-info", "set-option", "declare-sort", "declare-fun",
+    "declare-const", "define-fun", "assert", "check-sat", "push", "pop",
+    "exit", ":print-success"
+};
+}
+
+SmtLib::SmtLib(ostream& out, bool smtVerbose, bool satVerbose) : _out(out), _smt(smtVerbose, satVerbose){
+    for(const char* name : symbolNames) _symbols.intern(name, strlen(name));
+    _true = _smt.newVar();
+    _false = _smt.newVar();
+    // in the base scope, never popped.
+    addClause({Value::atom(SmtCnf::Literal::NOTEQ, _true, _false)});
+}
+
+void SmtLib::error(const string& msg) const {
+    throw SmtCnf::SmtSyntaxErr(_line, msg);
+}
+
+bool SmtLib::readCommand(SmtLibLexer& lex){
+    _tokens.clear();
+    int depth = 0;
+    do{
+        SmtLibLexer::Token t = lex.next();
+        if(_tokens.empty()) _line = lex.line();
+        switch(t.kind){
+        case SmtLibLexer::END:
+            if(_tokens.empty()) return false;
+            error("Unexpected end of input in a command");
+        case SmtLibLexer::LPAR:
+            _tokens.push_back(LPAR);
+            ++depth;
+            break;
+        case SmtLibLexer::RPAR:
+            if(depth == 0) error("Unexpected )");
+            _tokens.push_back(RPAR);
+            --depth;
+            break;
+        case SmtLibLexer::SYMBOL:
+            _tokens.push_back(_symbols.intern(t.text, t.size));
+            break;
+        case SmtLibLexer::STRING:
+            _tokens.push_back(STRING);
+            break;
+        }
+    } while(depth > 0);
+    if(_tokens.front() != LPAR) error("A command must start with (");
+    return true;
+}
+
+int SmtLib::take(const vector<int>& toks, size_t& pos, bool symbol) const {
+    if(pos >= toks.size()) error("Unexpected end of command");
+    int t = toks[pos++];
+    if(symbol and t < 0) error("Symbol expected");
+    return t;
+}
+
+void SmtLib::expect(const vector<int>& toks, size_t& pos, int token) const {
+    if(take(toks, pos) != token) error(token == LPAR ? "( expected" : ") expected");
+}
+
+void SmtLib::skipExpr(const vector<int>& toks, size_t& pos) const {
+    int t = take(toks, pos);
+    if(t == RPAR) error("Expression expected");
+    for(int depth = t == LPAR ; depth > 0 ; ){
+        t = take(toks, pos);
+        depth += (t == LPAR) - (t == RPAR);
+    }
+}
+
+int SmtLib::readSort(const vector<int>& toks, size_t& pos) const {
+    int s = take(toks, pos);
+    if(s == LPAR) error("Parametric sorts are not supported");
+    if(s < 0) error("Sort expected");
+    if(s != SYM_BOOL and (s >= (int)_decls.size() or _decls[s].kind != Decl::SORT)){
+        error("Unknown sort " + _symbols.name(s));
+    }
+    return s;
+}
+
+int SmtLib::readNumeral(const vector<int>& toks, size_t& pos) const {
+    string s = _symbols.name(take(toks, pos, true));
+    if(s.empty() or s.size() > 9 or s.find_first_not_of("0123456789") != string::npos){
+        error("Numeral expected");
+    }
+    return stoi(s);
+}
+
+void SmtLib::declare(int sym, Decl decl){
+    if(sym < NUM_SYMBOLS or (sym < (int)_decls.size() and _decls[sym].kind != Decl::NONE)){
+        error(_symbols.name(sym) + " is already declared");
+    }
+    if(sym >= (int)_decls.size()) _decls.resize(_symbols.size());
+    _decls[sym] = move(decl);
+    _declared.push_back(sym);
+}
+
+void SmtLib::declareFun(int sym, vector<int> argSorts, int sort){
+    Decl d;
+    d.kind = Decl::FUN;
+    d.sort = sort;
+    if(argSorts.empty()){
+        int t = _smt.newVar();
+        d.value = sort == SYM_BOOL ? Value::atom(SmtCnf::Literal::EQUAL, t, _true) : Value::ofTerm(t, sort);
+    }
+    else{
+        // a new function even if the name was used by a popped declaration.
+        d.fun = _numFuns++;
+    }
+    d.argSorts = move(argSorts);
+    declare(sym, move(d));
+}
+
+void SmtLib::checkBool(const vector<Value>& args) const {
+    for(const Value& v : args){
+        if(!isBool(v)) error("Boolean argument expected");
+    }
+}
+
+SmtLib::Value SmtLib::fresh(){
+    return Value::atom(SmtCnf::Literal::EQUAL, _smt.newVar(), _true);
+}
+
+SmtLib::Value SmtLib::negate(Value v){
+    switch(v.kind){
+    case Value::TRUE:
+        return Value::constant(false);
+    case Value::FALSE:
+        return Value::constant(true);
+    default:
+        v.lit.type = v.lit.type == SmtCnf::Literal::EQUAL ? SmtCnf::Literal::NOTEQ : SmtCnf::Literal::EQUAL;
+        return v;
+    }
+}
+
+void SmtLib::addClause(const vector<Value>& lits){
+    _clause.literals.clear();
+    for(const Value& v : lits){
+        if(v.kind == Value::TRUE) return;
+        if(v.kind == Value::LIT) _clause.literals.push_back(v.lit);
+    }
+    _smt.assertClause(_clause);
+}
+
+SmtLib::Value SmtLib::mkAnd(vector<Value>& args){
+    vector<Value> lits;
+    for(const Value& v : args){
+        if(v.kind == Value::FALSE) return v;
+        if(v.kind == Value::LIT) lits.push_back(v);
+    }
+    if(lits.empty()) return Value::constant(true);
+    if(lits.size() == 1) return lits[0];
+    // x <=> l1 and ... and ln
+    Value x = fresh();
+    for(Value& l : lits){
+        addClause({negate(x), l});
+        l = negate(l);
+    }
+    lits.push_back(x);
+    addClause(lits);
+    return x;
+}
+
+SmtLib::Value SmtLib::mkIff(Value a, Value b){
+    if(a.kind == Value::TRUE) return b;
+    if(a.kind == Value::FALSE) return negate(b);
+    if(b.kind != Value::LIT) return mkIff(b, a);
+    if(a.lit.var1 == b.lit.var1 and a.lit.var2 == b.lit.var2){
+        return Value::constant(a.lit.type == b.lit.type);
+    }
+    Value x = fresh();
+    addClause({negate(x), negate(a), b});
+    addClause({negate(x), a, negate(b)});
+    addClause({x, a, b});
+    addClause({x, negate(a), negate(b)});
+    return x;
+}
+
+SmtLib::Value SmtLib::mkIte(Value c, Value a, Value b){
+    if(!isBool(c)) error("Boolean condition expected");
+    if(isBool(a) != isBool(b) or (!isBool(a) and a.sort != b.sort)) error("Branches of ite of different sorts");
+    if(c.kind == Value::TRUE) return a;
+    if(c.kind == Value::FALSE) return b;
+    if(!isBool(a)){
+        if(a.term == b.term) return a;
+        Value v = Value::ofTerm(_smt.newVar(), a.sort);
+        addClause({negate(c), mkEq(v, a)});
+        addClause({c, mkEq(v, b)});
+        return v;
+    }
+    if(a.kind != Value::LIT or b.kind != Value::LIT){
+        // ite(c, true, b) is c or b, ite(c, false, b) is not c and b, and
+        // the same with the other branch.
+        vector<Value> args;
+        bool neg;
+        if(a.kind != Value::LIT){
+            neg = a.kind == Value::TRUE;
+            args = {negate(c), neg ? negate(b) : b};
+        }
+        else{
+            neg = b.kind == Value::TRUE;
+            args = {c, neg ? negate(a) : a};
+        }
+        Value v = mkAnd(args);
+        return neg ? negate(v) : v;
+    }
+    Value x = fresh();
+    addClause({negate(c), negate(a), x});
+    addClause({negate(c), a, negate(x)});
+    addClause({c, negate(b), x});
+    addClause({c, b, negate(x)});
+    // redundant, but they propagate x without c.
+    addClause({negate(a), negate(b), x});
+    addClause({a, b, negate(x)});
+    return x;
+}
+
+SmtLib::Value SmtLib::mkEq(Value a, Value b){
+    if(isBool(a) and isBool(b)) return mkIff(a, b);
+    if(isBool(a) or isBool(b) or a.sort != b.sort) error("Equality of terms of different sorts");
+    if(a.term == b.term) return Value::constant(true);
+    return Value::atom(SmtCnf::Literal::EQUAL, min(a.term, b.term), max(a.term, b.term));
+}
+
+int SmtLib::termOf(Value v){
+    if(v.kind == Value::TRUE) return _true;
+    if(v.kind == Value::FALSE) return _false;
+    int t = _smt.newVar();
+    addClause({negate(v), Value::atom(SmtCnf::Literal::EQUAL, t, _true)});
+    addClause({v, Value::atom(SmtCnf::Literal::EQUAL, t, _false)});
+    return t;
+}
+
+SmtLib::Value SmtLib::eval(const vector<int>& toks, size_t& pos){
+    int t = take(toks, pos);
+    if(t == RPAR or t == STRING) error("Expression expected");
+    vector<Value> args;
+    if(t >= 0){
+        if(t < (int)_bound.size() and _bound[t] != -1) return _values[_bound[t]];
+        if(t == SYM_TRUE or t == SYM_FALSE) return Value::constant(t == SYM_TRUE);
+        return apply(t, args);
+    }
+    int head = take(toks, pos);
+    if(head < 0) error("Indexed and qualified identifiers are not supported");
+    if(head == SYM_LET) return evalLet(toks, pos);
+    if(head == SYM_BANG){
+        // the attributes (:named, :pattern) don't change the value.
+        Value v = eval(toks, pos);
+        while(toks[pos] != RPAR) skipExpr(toks, pos);
+        ++pos;
+        return v;
+    }
+    while(toks[pos] != RPAR) args.push_back(eval(toks, pos));
+    ++pos;
+    return apply(head, args);
+}
+
+SmtLib::Value SmtLib::evalLet(const vector<int>& toks, size_t& pos){
+    // the expressions are evaluated before any symbol is bound.
+    vector<pair<int, Value>> binds;
+    expect(toks, pos, LPAR);
+    while(toks[pos] != RPAR){
+        expect(toks, pos, LPAR);
+        int sym = take(toks, pos, true);
+        binds.push_back(make_pair(sym, eval(toks, pos)));
+        expect(toks, pos, RPAR);
+    }
+    ++pos;
+    if(_bound.size() < _symbols.size()) _bound.resize(_symbols.size(), -1);
+    size_t numValues = _values.size();
+    vector<int> old;
+    for(const auto& b : binds){
+        old.push_back(_bound[b.first]);
+        _bound[b.first] = _values.size();
+        _values.push_back(b.second);
+    }
+    Value v = eval(toks, pos);
+    expect(toks, pos, RPAR);
+    for(size_t i = binds.size() ; i-- > 0 ; ) _bound[binds[i].first] = old[i];
+    _values.resize(numValues);
+    return v;
+}
+
+SmtLib::Value SmtLib::apply(int fun, vector<Value>& args){
+    auto arity = [&](size_t n, bool atLeast){
+        if(args.size() < n or (!atLeast and args.size() > n)){
+            error("Wrong number of arguments for " + _symbols.name(fun));
+        }
+    };
+    switch(fun){
+    case SYM_NOT:
+        arity(1, false);
+        checkBool(args);
+        return negate(args[0]);
+    case SYM_AND:
+        checkBool(args);
+        return mkAnd(args);
+    case SYM_OR:{
+        checkBool(args);
+        for(Value& v : args) v = negate(v);
+        return negate(mkAnd(args));
+    }
+    case SYM_XOR:{
+        arity(2, true);
+        checkBool(args);
+        Value v = args[0];
+        for(size_t i = 1 ; i < args.size() ; ++i) v = negate(mkIff(v, args[i]));
+        return v;
+    }
+    case SYM_IMPLIES:
+        // a1 => ... => an is not a1 or ... or not an-1 or an.
+        arity(2, true);
+        checkBool(args);
+        args.back() = negate(args.back());
+        return negate(mkAnd(args));
+    case SYM_EQ:
+    case SYM_DISTINCT:{
+        arity(2, true);
+        vector<Value> conj;
+        if(fun == SYM_EQ){
+            for(size_t i = 0 ; i+1 < args.size() ; ++i) conj.push_back(mkEq(args[i], args[i+1]));
+        }
+        else{
+            for(size_t i = 0 ; i < args.size() ; ++i){
+                for(size_t j = i+1 ; j < args.size() ; ++j) conj.push_back(negate(mkEq(args[i], args[j])));
+            }
+        }
+        return mkAnd(conj);
+    }
+    case SYM_ITE:
+        arity(3, false);
+        return mkIte(args[0], args[1], args[2]);
+    }
+
+    if(fun >= (int)_decls.size() or _decls[fun].kind == Decl::NONE or _decls[fun].kind == Decl::SORT){
+        error("Unknown symbol " + _symbols.name(fun));
+    }
+    const Decl& d = _decls[fun];
+    arity(d.argSorts.size(), false);
+    for(size_t i = 0 ; i < args.size() ; ++i){
+        int sort = d.argSorts[i];
+        if(sort == SYM_BOOL ? !isBool(args[i]) : isBool(args[i]) or args[i].sort != sort){
+            error("Argument " + to_string(i+1) + " of " + _symbols.name(fun) + " has the wrong sort");
+        }
+    }
+    if(d.kind == Decl::MACRO){
+        if(_bound.size() < _symbols.size()) _bound.resize(_symbols.size(), -1);
+        size_t numValues = _values.size();
+        vector<int> old;
+        for(size_t i = 0 ; i < args.size() ; ++i){
+            old.push_back(_bound[d.params[i]]);
+            _bound[d.params[i]] = _values.size();
+            _values.push_back(args[i]);
+        }
+        size_t pos = 0;
+        Value v = eval(d.body, pos);
+        for(size_t i = args.size() ; i-- > 0 ; ) _bound[d.params[i]] = old[i];
+        _values.resize(numValues);
+        if(d.sort == SYM_BOOL ? !isBool(v) : isBool(v) or v.sort != d.sort){
+            error("The body of " + _symbols.name(fun) + " has the wrong sort");
+        }
+        return v;
+    }
+    if(args.empty()) return d.value;
+    vector<int> terms;
+    for(const Value& v : args) terms.push_back(isBool(v) ? termOf(v) : v.term);
+    int t = _smt.app(d.fun, terms);
+    if(d.sort == SYM_BOOL) return Value::atom(SmtCnf::Literal::EQUAL, t, _true);
+    return Value::ofTerm(t, d.sort);
+}
+
+void SmtLib::assertExpr(const vector<int>& toks, size_t& pos, bool positive){
+    int head = toks[pos] == LPAR ? toks[pos+1] : -1;
+    bool clause = (head == SYM_OR and positive) or (head == SYM_AND and !positive);
+    bool conj = (head == SYM_AND and positive) or (head == SYM_OR and !positive);
+    if(head == SYM_NOT){
+        pos += 2;
+        assertExpr(toks, pos, !positive);
+        expect(toks, pos, RPAR);
+    }
+    else if(conj){
+        pos += 2;
+        while(toks[pos] != RPAR) assertExpr(toks, pos, positive);
+        ++pos;
+    }
+    else if(clause or head == SYM_IMPLIES){
+        pos += 2;
+        vector<Value> lits;
+        while(toks[pos] != RPAR) lits.push_back(eval(toks, pos));
+        ++pos;
+        checkBool(lits);
+        if(head == SYM_IMPLIES){
+            if(lits.size() < 2) error("Wrong number of arguments for =>");
+            // not (a1 => ... => an) is a1 and ... and an-1 and not an.
+            for(size_t i = 0 ; i+1 < lits.size() ; ++i) lits[i] = negate(lits[i]);
+            if(!positive){
+                for(const Value& v : lits) addClause({negate(v)});
+                return;
+            }
+        }
+        else if(!positive){
+            for(Value& v : lits) v = negate(v);
+        }
+        addClause(lits);
+    }
+    else{
+        Value v = eval(toks, pos);
+        if(!isBool(v)) error("Boolean assertion expected");
+        addClause({positive ? v : negate(v)});
+    }
+}
+
+void SmtLib::push(int n){
+    for(int i = 0 ; i < n ; ++i){
+        _smt.push();
+        _scopes.push_back(_declared.size());
+    }
+}
+
+void SmtLib::pop(int n){
+    if(n > (int)_scopes.size()) error("pop of more scopes than are open");
+    for(int i = 0 ; i < n ; ++i){
+        _smt.pop();
+        while(_declared.size() > _scopes.back()){
+            _decls[_declared.back()] = Decl();
+            _declared.pop_back();
+        }
+        _scopes.pop_back();
+    }
+}
+
+void SmtLib::run(InputBuffer& in){
+    SmtLibLexer lex(in);
+    while(readCommand(lex)){
+        size_t pos = 1;
+        int cmd = take(_tokens, pos, true);
+        switch(cmd){
+        case SYM_SET_LOGIC:
+            take(_tokens, pos, true);
+            break;
+        case SYM_SET_OPTION:
+            if(_tokens[pos] == SYM_PRINT_SUCCESS){
+                ++pos;
+                _printSuccess = take(_tokens, pos, true) == SYM_TRUE;
+                break;
+            }
+            // the other options are ignored.
+            // fall through
+        case SYM_SET_INFO:
+            pos = _tokens.size() -1;
+            break;
+        case SYM_DECLARE_SORT:{
+            int sym = take(_tokens, pos, true);
+            if(readNumeral(_tokens, pos) != 0) error("Sorts with parameters are not supported");
+            Decl d;
+            d.kind = Decl::SORT;
+            declare(sym, move(d));
+            break;
+        }
+        case SYM_DECLARE_FUN:
+        case SYM_DECLARE_CONST:{
+            int sym = take(_tokens, pos, true);
+            vector<int> argSorts;
+            if(cmd == SYM_DECLARE_FUN){
+                expect(_tokens, pos, LPAR);
+                while(_tokens[pos] != RPAR) argSorts.push_back(readSort(_tokens, pos));
+                ++pos;
+            }
+            int sort = readSort(_tokens, pos);
+            declareFun(sym, move(argSorts), sort);
+            break;
+        }
+        case SYM_DEFINE_FUN:{
+            Decl d;
+            d.kind = Decl::MACRO;
+            int sym = take(_tokens, pos, true);
+            expect(_tokens, pos, LPAR);
+            while(_tokens[pos] != RPAR){
+                expect(_tokens, pos, LPAR);
+                d.params.push_back(take(_tokens, pos, true));
+                d.argSorts.push_back(readSort(_tokens, pos));
+                expect(_tokens, pos, RPAR);
+            }
+            ++pos;
+            d.sort = readSort(_tokens, pos);
+            size_t start = pos;
+            skipExpr(_tokens, pos);
+            d.body.assign(_tokens.begin() + start, _tokens.begin() + pos);
+            declare(sym, move(d));
+            break;
+        }
+        case SYM_ASSERT:
+            assertExpr(_tokens, pos, true);
+            break;
+        case SYM_CHECK_SAT:
+            _out << (_smt.check() ? "sat" : "unsat") << endl;
+            break;
+        case SYM_PUSH:
+        case SYM_POP:{
+            int n = _tokens[pos] == RPAR ? 1 : readNumeral(_tokens, pos);
+            if(cmd == SYM_PUSH) push(n);
+            else pop(n);
+            break;
+        }
+        case SYM_EXIT:
+            if(_printSuccess) _out << "success" << endl;
+            return;
+        default:
+            _out << "unsupported" << endl;
+            continue;
+        }
+        expect(_tokens, pos, RPAR);
+        if(_printSuccess and cmd != SYM_CHECK_SAT) _out << "success" << endl;
+    }
+}
@@ -0,0 +1,144 @@
+#ifndef SMTLIB_H
+#define SMTLIB_H
+
+#include <ostream>
+#include <vector>
+#include "SmtCnf.h"
+#include "SmtIncremental.h"
+#include "SmtLibLexer.h"
+
+/**
+   @brief Interpreter of SMT-LIB 2 scripts in QF_UF : declared sorts, Bool,
+   uninterpreted functions and constants, and their boolean combinations.
+
+   Each command is read as a list of tokens (symbol ids, and negative codes for
+   the parentheses), then run. Terms and formulas go to a SmtIncremental, so
+   check-sat, push and pop keep the work of the previous checks. A formula is
+   flattened into clauses of equalities (Tseitin) : a boolean is an atom x = T
+   on a term x of its own, where T is a term different from another one F.
+   Each connective gets such a fresh atom, defined by clauses on the atoms of its
+   arguments, except the and, or, not and => at the top of an assertion, which
+   give their clauses directly. A boolean argument of a function is the term T
+   or F, chosen by two clauses, so equal booleans are equal terms.
+
+   The declarations made in a scope are removed by its pop. define-fun is
+   expanded at each use, and let binds the value of its expressions. The answers
+   (sat or unsat, success if :print-success is set, unsupported for the other
+   commands) are written to out. A syntax error or an ill-sorted term throws
+   SmtCnf::SmtSyntaxErr.
+ */
+class SmtLib{
+    // value of an expression : a term, or a formula given by a literal or a constant.
+    struct Value{
+        enum Kind{TERM, LIT, TRUE, FALSE};
+        Kind kind = FALSE;
+        // TERM : term and its sort.
+        int term = -1;
+        int sort = -1;
+        // LIT
+        SmtCnf::Literal lit = {SmtCnf::Literal::EQUAL, -1, -1};
+
+        static Value constant(bool b){
+            Value v;
+            v.kind = b ? TRUE : FALSE;
+            return v;
+        }
+        static Value ofTerm(int term, int sort){
+            Value v;
+            v.kind = TERM;
+            v.term = term;
+            v.sort = sort;
+            return v;
+        }
+        static Value atom(SmtCnf::Literal::Type type, int a, int b){
+            Value v;
+            v.kind = LIT;
+            v.lit = SmtCnf::Literal{type, a, b};
+            return v;
+        }
+    };
+    // what a symbol is declared as.
+    struct Decl{
+        enum Kind{NONE, SORT, FUN, MACRO};
+        Kind kind = NONE;
+        // sorts of the arguments, and result sort.
+        std::vector<int> argSorts;
+        int sort = -1;
+        // FUN with arguments : function of the solver.
+        int fun = -1;
+        // FUN without argument : its value.
+        Value value;
+        // MACRO : parameters and body.
+        std::vector<int> params;
+        std::vector<int> body;
+    };
+
+    std::ostream& _out;
+    SymbolTable _symbols;
+    SmtIncremental _smt;
+    // the terms of true and false.
+    int _true;
+    int _false;
+    int _numFuns = 0;
+    bool _printSuccess = false;
+
+    std::vector<Decl> _decls;
+    // symbols declared in the open scopes, and the first one of each scope.
+    std::vector<int> _declared;
+    std::vector<size_t> _scopes;
+    // values bound by let and by the parameters of a macro, -1 if none.
+    std::vector<int> _bound;
+    std::vector<Value> _values;
+
+    // tokens of the command being run.
+    std::vector<int> _tokens;
+    size_t _line = 0;
+    SmtCnf::Clause _clause;
+
+    [[noreturn]] void error(const std::string& msg) const;
+    // Read the tokens of the next command, false at the end of the input.
+    bool readCommand(SmtLibLexer& lex);
+    // Token at pos, which is skipped. Symbol expected if symbol is true.
+    int take(const std::vector<int>& toks, size_t& pos, bool symbol = false) const;
+    void expect(const std::vector<int>& toks, size_t& pos, int token) const;
+    // Skip the expression at pos.
+    void skipExpr(const std::vector<int>& toks, size_t& pos) const;
+    int readSort(const std::vector<int>& toks, size_t& pos) const;
+    int readNumeral(const std::vector<int>& toks, size_t& pos) const;
+    void declare(int sym, Decl decl);
+    void declareFun(int sym, std::vector<int> argSorts, int sort);
+
+    Value eval(const std::vector<int>& toks, size_t& pos);
+    Value evalLet(const std::vector<int>& toks, size_t& pos);
+    Value apply(int fun, std::vector<Value>& args);
+    // Assert the formula at pos, or its negation if positive is false.
+    void assertExpr(const std::vector<int>& toks, size_t& pos, bool positive);
+
+    bool isBool(const Value& v) const {
+        return v.kind != Value::TERM;
+    }
+    void checkBool(const std::vector<Value>& args) const;
+    Value fresh();
+    static Value negate(Value v);
+    Value mkAnd(std::vector<Value>& args);
+    Value mkIff(Value a, Value b);
+    Value mkIte(Value c, Value a, Value b);
+    Value mkEq(Value a, Value b);
+    // Term of a boolean : T or F.
+    int termOf(Value v);
+    // Assert the clause of the literals, constants included.
+    void addClause(const std::vector<Value>& lits);
+
+    void push(int n);
+    void pop(int n);
+
+public:
+    SmtLib(std::ostream& out, bool smtVerbose = false, bool satVerbose = false);
+    SmtLib(const SmtLib&) = delete;
+    SmtLib& operator=(const SmtLib&) = delete;
+
+    // Run the commands of in until its end or exit.
+    void run(InputBuffer& in);
+};
+
+#endif
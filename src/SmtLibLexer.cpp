@@ -0,0 +1,149 @@
+#include "SmtLibLexer.h"
+#include <algorithm>
+#include <cstring>
+#include "InputBuffer.h"
+#include "SmtCnf.h"
+
+using namespace std;
+
+size_t SymbolTable::hash(const char* name, size_t size){
+    // FNV-1a
+    size_t h = 0xcbf29ce484222325ULL;
+    for(size_t i = 0 ; i < size ; ++i){
+        h = (h ^ (unsigned char)name[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+bool SymbolTable::equal(int id, const char* name, size_t size) const {
+    return _start[id+1] - _start[id] == size and memcmp(_chars.data() + _start[id], name, size) == 0;
+}
+
+void SymbolTable::grow(){
+    _slots.assign(_slots.size() * 2, -1);
+    size_t mask = _slots.size() -1;
+    for(size_t id = 0 ; id < _hash.size() ; ++id){
+        size_t i = _hash[id] & mask;
+        while(_slots[i] != -1) i = (i+1) & mask;
+        _slots[i] = id;
+    }
+}
+
+int SymbolTable::find(const char* name, size_t size) const {
+    size_t mask = _slots.size() -1;
+    size_t h = hash(name, size);
+    for(size_t i = h & mask ; _slots[i] != -1 ; i = (i+1) & mask){
+        int id = _slots[i];
+        if(_hash[id] == h and equal(id, name, size)) return id;
+    }
+    return -1;
+}
+
+int SymbolTable::intern(const char* name, size_t size){
+    size_t mask = _slots.size() -1;
+    size_t h = hash(name, size);
+    size_t i = h & mask;
+    for(; _slots[i] != -1 ; i = (i+1) & mask){
+        int id = _slots[i];
+        if(_hash[id] == h and equal(id, name, size)) return id;
+    }
+    int id = _hash.size();
+    _chars.insert(_chars.end(), name, name + size);
+    _start.push_back(_chars.size());
+    _hash.push_back(h);
+    _slots[i] = id;
+    if(2 * _hash.size() > _slots.size()) grow();
+    return id;
+}
+
+namespace {
+// Bytes that end a symbol or a numeral.
+struct Delimiters{
+    bool table[256] = {};
+    Delimiters(){
+        for(unsigned char c : string(" \t\r\n();\"|")) table[c] = true;
+    }
+    bool operator()(char c) const {
+        return table[(unsigned char)c];
+    }
+};
+const Delimiters delimiter;
+}
+
+void SmtLibLexer::skipBlanks(){
+    while(true){
+        const char* p = _in.chunk();
+        size_t n = _in.available();
+        size_t i = 0;
+        while(i < n and (p[i] == ' ' or p[i] == '\t' or p[i] == '\r' or p[i] == '\n')){
+            _line += p[i] == '\n';
+            ++i;
+        }
+        _in.skip(i);
+        if(i < n and p[i] == ';'){
+            _in.skipLine();
+            ++_line;
+        }
+        else if(i < n or n == 0) return;
+    }
+}
+
+template<typename Stop>
+SmtLibLexer::Token SmtLibLexer::scan(Kind kind, Stop stop){
+    _long.clear();
+    bool copied = false;
+    while(true){
+        const char* p = _in.chunk();
+        size_t n = _in.available();
+        size_t i = 0;
+        while(i < n and !stop(p[i])) ++i;
+        if(i < n or n == 0){
+            _in.skip(i);
+            if(!copied) return Token{kind, p, i};
+            _long.append(p, i);
+            return Token{kind, _long.data(), _long.size()};
+        }
+        // the token goes on in the next chunk.
+        _long.append(p, n);
+        _in.skip(n);
+        copied = true;
+    }
+}
+
+SmtLibLexer::Token SmtLibLexer::next(){
+    skipBlanks();
+    const char* p = _in.chunk();
+    if(_in.available() == 0) return Token{END, nullptr, 0};
+    switch(*p){
+    case '(':
+        _in.skip(1);
+        return Token{LPAR, p, 1};
+    case ')':
+        _in.skip(1);
+        return Token{RPAR, p, 1};
+    case '|':{
+        _in.skip(1);
+        Token t = scan(SYMBOL, [](char c){ return c == '|'; });
+        _line += count(t.text, t.text + t.size, '\n');
+        // the closing bar is still in the chunk of the token.
+        if(_in.available() == 0) throw SmtCnf::SmtSyntaxErr(_line, "Unterminated quoted symbol");
+        _in.skip(1);
+        return t;
+    }
+    case '"':
+        _in.skip(1);
+        while(true){
+            Token t = scan(STRING, [](char c){ return c == '"'; });
+            _line += count(t.text, t.text + t.size, '\n');
+            if(_in.available() == 0) throw SmtCnf::SmtSyntaxErr(_line, "Unterminated string");
+            _in.skip(1);
+            // "" is a quote in the string.
+            const char* q = _in.chunk();
+            if(_in.available() == 0 or *q != '"') break;
+            _in.skip(1);
+        }
+        return Token{STRING, nullptr, 0};
+    default:
+        return scan(SYMBOL, delimiter);
+    }
+}
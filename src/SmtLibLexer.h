@@ -0,0 +1,89 @@
+#ifndef SMTLIBLEXER_H
+#define SMTLIBLEXER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class InputBuffer;
+
+/**
+   @brief Names of the symbols of a SMT-LIB script, numbered densely from 0 in
+   order of first appearance.
+
+   The names are stored one after the other in one array, as the clauses of a
+   ClausePool, and the ids are in a flat open-addressing table keyed by the
+   hash of the name, kept at most half full. A lookup hashes the bytes where
+   they are : a name is copied only the first time it is seen.
+ */
+class SymbolTable{
+    std::vector<char> _chars;
+    // name i is [_start[i], _start[i+1]) in _chars.
+    std::vector<size_t> _start = std::vector<size_t>(1, 0);
+    std::vector<size_t> _hash;
+    // id of each slot, -1 if empty.
+    std::vector<int> _slots = std::vector<int>(16, -1);
+
+    static size_t hash(const char* name, size_t size);
+    bool equal(int id, const char* name, size_t size) const;
+    void grow();
+
+public:
+    // Id of the name, added if it is new.
+    int intern(const char* name, size_t size);
+    int intern(const std::string& name){
+        return intern(name.data(), name.size());
+    }
+    // Id of the name, -1 if absent.
+    int find(const char* name, size_t size) const;
+    std::string name(int id) const {
+        return std::string(_chars.data() + _start[id], _chars.data() + _start[id+1]);
+    }
+    size_t size() const {
+        return _start.size() -1;
+    }
+};
+
+/**
+   @brief Tokens of a SMT-LIB 2 script, read from an InputBuffer.
+
+   The text of a token is given where it is in the chunk of the input (the map
+   of a file, or the block buffer), without any copy. A token that crosses the
+   end of a block is the only one copied, in a buffer of the lexer. The text of
+   a quoted symbol |...| is the text between the bars, so |x| and x are the
+   same symbol. Numerals, keywords and the other symbols are all SYMBOL tokens.
+   The text of a string is not kept.
+ */
+class SmtLibLexer{
+public:
+    enum Kind{LPAR, RPAR, SYMBOL, STRING, END};
+    struct Token{
+        Kind kind;
+        // valid until the next token is read.
+        const char* text;
+        size_t size;
+    };
+
+private:
+    InputBuffer& _in;
+    size_t _line = 1;
+    // text of a token that crosses the end of a chunk.
+    std::string _long;
+
+    // Skip the spaces and the comments.
+    void skipBlanks();
+    // Text of the longest run of bytes that are not stop, at most until the end of the input.
+    template<typename Stop>
+    Token scan(Kind kind, Stop stop);
+
+public:
+    explicit SmtLibLexer(InputBuffer& in) : _in(in){}
+
+    Token next();
+    // Line of the last token read.
+    size_t line() const {
+        return _line;
+    }
+};
+
+#endif
@@ -0,0 +1,171 @@
+#include "SmtPreprocess.h"
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+namespace {
+// Union-find with path halving, the representative is the smallest variable.
+struct UnionFind{
+    vector<int> parent;
+    explicit UnionFind(size_t n) : parent(n){
+        iota(parent.begin(), parent.end(), 0);
+    }
+    int find(int i){
+        while(parent[i] != i){
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+    // Return false if a and b were already merged.
+    bool merge(int a, int b){
+        a = find(a);
+        b = find(b);
+        if(a == b) return false;
+        if(a < b) parent[b] = a;
+        else parent[a] = b;
+        return true;
+    }
+};
+
+// Rewrite cl on the representatives of uf. Return false if cl is true.
+// The order of the literals is kept, the search of the SAT solver depends on it.
+bool rewrite(SmtCnf::Clause& cl, UnionFind& uf){
+    size_t j = 0;
+    for(auto lit : cl.literals){
+        lit.var1 = uf.find(lit.var1);
+        lit.var2 = uf.find(lit.var2);
+        if(lit.var2 < lit.var1) swap(lit.var1, lit.var2);
+        if(lit.var1 == lit.var2){
+            if(lit.type == SmtCnf::Literal::EQUAL) return false; // x = x
+            continue; // x <> x
+        }
+        bool dup = false;
+        for(size_t i = 0 ; i < j ; ++i){
+            const auto& prev = cl.literals[i];
+            if(prev.var1 != lit.var1 or prev.var2 != lit.var2) continue;
+            if(prev.type != lit.type) return false; // x = y or x <> y
+            dup = true;
+            break;
+        }
+        if(!dup) cl.literals[j++] = lit;
+    }
+    cl.literals.resize(j);
+    return true;
+}
+}
+
+SmtPreprocess preprocess(const SmtCnf& sc){
+    SmtPreprocess res(sc._numVar);
+    UnionFind uf(sc._numVar);
+    // the clauses are rewritten : they are copied out of the pool of sc.
+    vector<SmtCnf::Clause> clauses;
+    clauses.reserve(sc.clauses.size());
+    for(const auto& cl : sc.clauses){
+        clauses.push_back(SmtCnf::Clause{{cl.literals.begin(), cl.literals.end()}});
+    }
+
+    bool merged = true;
+    while(merged){
+        merged = false;
+        for(const auto& cl : clauses){
+            if(cl.literals.size() == 1 and cl.literals[0].type == SmtCnf::Literal::EQUAL){
+                merged |= uf.merge(cl.literals[0].var1, cl.literals[0].var2);
+            }
+        }
+        size_t j = 0;
+        for(size_t i = 0 ; i < clauses.size() ; ++i){
+            if(!rewrite(clauses[i], uf)) continue;
+            if(clauses[i].literals.empty()){
+                res.unsat = true;
+                return res;
+            }
+            if(i != j) clauses[j] = move(clauses[i]);
+            ++j;
+        }
+        clauses.resize(j);
+    }
+
+    // the terms of the applications are kept : their values are bound by congruence.
+    vector<SmtCnf::App> apps = sc.apps;
+    vector<bool> used(sc._numVar, false);
+    for(auto& app : apps){
+        app.term = uf.find(app.term);
+        used[app.term] = true;
+        for(int& a : app.args){
+            a = uf.find(a);
+            used[a] = true;
+        }
+    }
+
+    // elimination of the variables without equality.
+    vector<bool> alive(clauses.size(), true);
+    vector<int> numEq(sc._numVar);
+    bool eliminated = true;
+    while(eliminated){
+        eliminated = false;
+        fill(numEq.begin(), numEq.end(), 0);
+        for(size_t i = 0 ; i < clauses.size() ; ++i){
+            if(!alive[i]) continue;
+            for(auto& lit : clauses[i].literals){
+                if(lit.type == SmtCnf::Literal::EQUAL){
+                    ++numEq[lit.var1];
+                    ++numEq[lit.var2];
+                }
+            }
+        }
+        for(size_t i = 0 ; i < clauses.size() ; ++i){
+            if(!alive[i]) continue;
+            for(auto& lit : clauses[i].literals){
+                if(lit.type == SmtCnf::Literal::NOTEQ
+                   and ((!numEq[lit.var1] and !used[lit.var1]) or (!numEq[lit.var2] and !used[lit.var2]))){
+                    alive[i] = false;
+                    eliminated = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    // renumbering.
+    for(int v = 0 ; v < sc._numVar ; ++v){
+        res.rep[v] = uf.find(v);
+    }
+    for(size_t i = 0 ; i < clauses.size() ; ++i){
+        if(!alive[i]) continue;
+        for(auto& lit : clauses[i].literals){
+            used[lit.var1] = used[lit.var2] = true;
+        }
+    }
+    int numVar = 0;
+    for(int v = 0 ; v < sc._numVar ; ++v){
+        if(used[v]) res.index[v] = numVar++;
+    }
+    for(size_t i = 0 ; i < clauses.size() ; ++i){
+        if(!alive[i]) continue;
+        for(auto& lit : clauses[i].literals){
+            lit.var1 = res.index[lit.var1];
+            lit.var2 = res.index[lit.var2];
+        }
+        res.cnf.clauses.push_back(clauses[i]);
+    }
+    for(auto& app : apps){
+        app.term = res.index[app.term];
+        for(int& a : app.args) a = res.index[a];
+    }
+    res.cnf.apps = move(apps);
+    res.cnf._numVar = numVar;
+    return res;
+}
+
+vector<int> SmtPreprocess::reconstruct(const vector<int>& sol) const {
+    int offset = 0;
+    for(int c : sol) offset = max(offset, c+1);
+    vector<int> res(rep.size());
+    for(size_t v = 0 ; v < rep.size() ; ++v){
+        int r = rep[v];
+        res[v] = index[r] != -1 ? sol[index[r]] : offset + r;
+    }
+    return res;
+}
@@ -0,0 +1,43 @@
+#ifndef SMTPREPROCESS_H
+#define SMTPREPROCESS_H
+
+#include <vector>
+#include "SmtCnf.h"
+
+/**
+   @brief Simplification of a SMT formula before its SAT encoding (see gene()).
+
+   Until nothing changes :
+       - the variables of the unit clauses x = y are merged,
+       - each literal is rewritten on the representatives of its variables,
+         x = x makes its clause true (it is dropped), x <> x is false (it is removed
+         from its clause, an empty clause makes the formula UNSAT),
+       - duplicated literals and clauses with both x = y and x <> y are cleaned.
+   Then the variables that only appear in disequalities are eliminated : they can
+   take a value of their own, so all the clauses where they appear are true.
+   The terms of the function applications (and their arguments) are never eliminated.
+
+   The remaining variables are renumbered from 0 in cnf.
+ */
+struct SmtPreprocess{
+    SmtCnf cnf;
+    // The formula is UNSAT (cnf is then meaningless).
+    bool unsat = false;
+    // Representative of each original variable (the merged variables share it).
+    std::vector<int> rep;
+    // Variable of cnf of each representative, -1 if it is not in cnf.
+    std::vector<int> index;
+
+    explicit SmtPreprocess(int nVar) : cnf(0), rep(nVar), index(nVar, -1){}
+
+    /**
+       Model of the original formula from a model (classes of the variables) of cnf :
+       the merged variables get the class of their representative, and the eliminated
+       ones get a class of their own.
+     */
+    std::vector<int> reconstruct(const std::vector<int>& sol) const;
+};
+
+SmtPreprocess preprocess(const SmtCnf& sc);
+
+#endif
@@ -1,252 +1,468 @@
 #include "SmtSolver.h"
-#include <queue>
 #include <cassert>
+#include <algorithm>
 #include <iostream>
+#include <atomic>
 #include "SatSolver.h"
+#include "SmallSolver.h"
+#include "EqTheory.h"
+#include "Transitivity.h"
+#include "SmtPreprocess.h"
+#include "Decompose.h"
+#include "Parallel.h"
 
-std::pair<int, int> mkOrderedPair(int a, int b) {
-    if(a <= b) {
-        return std::make_pair(a, b);
-    } else {
-        return std::make_pair(b, a);
+//En dessous de ce nombre de sommets visités par les BFS de decide(),
+//tout est fait dans le thread courant
+static const size_t parallelBfsThreshold = 1 << 16;
+
+void SmtSatKernel::buildGraph() {
+    //Tri par dénombrement : les atomes restent dans l'ordre dans chaque liste
+    adjStart.assign(numVar + 1, 0);
+    for(const auto& p : from) {
+        adjStart[p.first + 1] += 1;
+        if(p.second != p.first) {
+            adjStart[p.second + 1] += 1;
+        }
+    }
+    for(int v = 0; v < numVar; ++v) {
+        adjStart[v + 1] += adjStart[v];
+    }
+    adj.resize(adjStart[numVar]);
+    std::vector<int> pos(adjStart.begin(), adjStart.end() - 1);
+    for(size_t atom = 0; atom < from.size(); ++atom) {
+        int v1 = from[atom].first;
+        int v2 = from[atom].second;
+        adj[pos[v1]++] = std::make_pair(v2, atom);
+        if(v1 != v2) {
+            adj[pos[v2]++] = std::make_pair(v1, atom);
+        }
     }
 }
 
-std::pair<SmtSatKernel, SatCnf> gene(const SmtCnf& sc) {
+SmtSatKernel geneKernel(const SmtCnf& sc) {
     SmtSatKernel res;
-
-    SatCnf resCnf(-1);
-
-    for(const SmtCnf::Clause& c : sc.clauses) {
-        SatCnf::Clause curClause;
+    res.numVar = sc._numVar;
+    for(const auto& c : sc.clauses) {
         for(const SmtCnf::Literal& l : c.literals) {
-            int v1 = l.var1;
-            int v2 = l.var2;
-            if(v2 < v1) {
-                std::swap(v1, v2);
-            }
-            //v1 <= v2
-            std::pair<int, int> pair = std::make_pair(v1, v2);
-            if(res.to.count(pair)) {
-            } else {
-                res.to.insert(std::make_pair(pair, res.from.size()));
-                res.from.push_back(pair);
+            int v1 = std::min(l.var1, l.var2);
+            int v2 = std::max(l.var1, l.var2);
+            int atom = res.to.insert(v1, v2, res.from.size());
+            if(atom == (int)res.from.size()) {
+                res.from.push_back(std::make_pair(v1, v2));
             }
-            SatCnf::Literal curLit;
-            curLit.var = res.to[pair];
-            curLit.neg = (l.type == SmtCnf::Literal::NOTEQ);
-            curClause.literals.push_back(curLit);
         }
-        resCnf.clauses.push_back(curClause);
     }
-
-    resCnf._numVar = res.from.size();
-
-    return std::make_pair(res, resCnf);
+    res.buildGraph();
+    return res;
 }
 
-std::pair<bool, std::vector<int>> decide(const SmtSatKernel& ker, std::vector<bool> vals) {
-    assert(ker.from.size() == vals.size());
-    std::vector<std::vector<int>> graph(vals.size());
-    std::vector<std::pair<int, int>> forbidden;
+std::pair<SmtSatKernel, SatCnf> gene(const SmtCnf& sc) {
+    SmtSatKernel ker = geneKernel(sc);
+    SatCnf resCnf(ker.from.size());
+    resCnf.clauses.reserve(sc.clauses.size(), sc.clauses.numLiterals());
+    geneClauses(sc, ker, [&](SatCnf::ClauseRef cl) {
+            resCnf.clauses.push_back(cl);
+        });
+    return std::make_pair(std::move(ker), std::move(resCnf));
+}
 
-    //On génère le graphe d'égalité et quelles sont les égalités impossibles (forbidden)
-    for(size_t i = 0; i < ker.from.size(); ++i) {
-        int v1 = ker.from[i].first;
-        int v2 = ker.from[i].second;
-        if(vals[i]) {
-            graph[v1].push_back(v2);
-            graph[v2].push_back(v1);
-        } else {
-            forbidden.push_back(std::make_pair(v1, v2));
-        }
-    }
-
-    //Algorithme pour trouver les composantes connexes (linéaire)
-    struct CompConn {
-        const std::vector<std::vector<int>>& graph;
-        std::vector<int> comps;
-        CompConn(const std::vector<std::vector<int>>& _graph)
-            : graph(_graph), comps(_graph.size(), -1) {}
-
-        void dfs(size_t node, int comp) {
-            if(comps[node] != -1) return;
-            comps[node] = comp;
-            for(int neigh : graph[node]) {
-                dfs(neigh, comp);
+//BFS pour calculer le plus court chemin d'un point à tous les autres, sur le
+//graphe des atomes vrais. dists et queue sont les tableaux d'un thread
+static void shortestPaths(const SmtSatKernel& ker, const std::vector<bool>& vals, int start,
+                          std::vector<int>& dists, std::vector<int>& queue) {
+    dists.assign(ker.numVar, -1);
+    dists[start] = 0;
+    queue.clear();
+    queue.push_back(start);
+    for(size_t head = 0; head < queue.size(); ++head) {
+        int v = queue[head];
+        for(int i = ker.adjStart[v]; i < ker.adjStart[v+1]; ++i) {
+            int neigh = ker.adj[i].first;
+            if(vals[ker.adj[i].second] && dists[neigh] == -1) {
+                dists[neigh] = dists[v]+1;
+                queue.push_back(neigh);
             }
         }
+    }
+}
 
-        void compute() {
-            int curComp = 0;
-            for(size_t i = 0; i < graph.size(); ++i) {
-                if(comps[i] == -1) {
-                    dfs(i, curComp);
-                    curComp += 1;
-                }
+//Donne la "preuve" de l'égalité entre start et to : les atomes d'un plus court
+//chemin de to à start, puis l'atome faux forbAtom entre start et to
+static void recoverCounterExample(const SmtSatKernel& ker, const std::vector<bool>& vals,
+                                  const std::vector<int>& dists, int start, int to, int forbAtom,
+                                  std::vector<int>& res) {
+    res.clear();
+    int cur = to;
+    while(cur != start) {
+        for(int i = ker.adjStart[cur]; i < ker.adjStart[cur+1]; ++i) {
+            int neigh = ker.adj[i].first;
+            if(vals[ker.adj[i].second] && dists[cur] == dists[neigh]+1) {
+                res.push_back(ker.adj[i].second);
+                cur = neigh;
+                break;
             }
         }
-    };
+    }
+    res.push_back(forbAtom);
+}
 
-    CompConn cc(graph);
-    cc.compute();
-
-    //Calcul des "forbidden" qui crééent des conflits
-    std::vector<size_t> badForbidden;
-    for(size_t i = 0; i < forbidden.size(); ++i) {
-        if(cc.comps[forbidden[i].first] == cc.comps[forbidden[i].second]) {
-            badForbidden.push_back(i);
-        }
-    }
-
-    if(badForbidden.empty()) {
-        return std::make_pair(true, cc.comps);
-    }
-
-    //BFS pour calculer le plus court chemin d'un point à tous les autres
-    struct ShortestPath {
-        const std::vector<std::vector<int>>& graph;
-        const SmtSatKernel& ker;
-        std::vector<int> dists;
-        int startNode;
-        ShortestPath(const std::vector<std::vector<int>>& _graph, const SmtSatKernel& _ker)
-            : graph(_graph), ker(_ker), dists(_graph.size(), -1), startNode(-1) {}
-
-        void compute(int start) {
-            startNode = start;
-            dists.assign(graph.size(), -1);
-            dists[start] = 0;
-            std::queue<int> q;
-            q.push(start);
-            while(!q.empty()) {
-                int v = q.front();
-                q.pop();
-                for(int neigh : graph[v]) {
-                    if(dists[neigh] == -1) {
-                        dists[neigh] = dists[v]+1;
-                        q.push(neigh);
-                    }
-                }
-            }
-        }
+bool decide(const SmtSatKernel& ker, const std::vector<bool>& vals, DecideBuffers& buf,
+            size_t maxLemmas) {
+    assert(ker.from.size() == vals.size());
+    //Le graphe d'égalité est celui du noyau restreint aux atomes vrais
 
-        //Donne la "preuve" de l'égalité entre startNode et to
-        std::vector<int> recoverCounterExample(int to) {
-            std::vector<int> res;
-            int cur = to;
-            while(cur != startNode) {
-                for(int neigh : graph[cur]) {
-                    if(dists[cur] == dists[neigh]+1) {
-                        res.push_back(ker.to.at(mkOrderedPair(cur, neigh)));
-                        cur = neigh;
-                        break;
-                    }
+    //Composantes connexes (linéaire), par un parcours en profondeur avec une pile explicite
+    std::vector<int>& comps = buf.comps;
+    comps.assign(ker.numVar, -1);
+    int curComp = 0;
+    for(int i = 0; i < ker.numVar; ++i) {
+        if(comps[i] != -1) continue;
+        buf.stack.clear();
+        buf.stack.push_back(i);
+        comps[i] = curComp;
+        while(!buf.stack.empty()) {
+            int v = buf.stack.back();
+            buf.stack.pop_back();
+            for(int j = ker.adjStart[v]; j < ker.adjStart[v+1]; ++j) {
+                int neigh = ker.adj[j].first;
+                if(vals[ker.adj[j].second] && comps[neigh] == -1) {
+                    comps[neigh] = curComp;
+                    buf.stack.push_back(neigh);
                 }
             }
-            res.push_back(ker.to.at(mkOrderedPair(startNode, to)));
-            return res;
         }
-    };
+        curComp += 1;
+    }
 
-#if 0
-    //Algorithme linéaire mais ne fournit pas le contre-exemple minimal
-    //On prends un "forbidden" qui créé conflit, et on trouve le contre-exemple
-    //minimal pour celui-ci
+    //Calcul des "forbidden" (atomes faux) et de ceux qui crééent des conflits
+    buf.forbidden.clear();
+    bool conflict = false;
+    for(size_t i = 0; i < ker.from.size(); ++i) {
+        if(!vals[i]) {
+            buf.forbidden.push_back(i);
+            conflict = conflict || comps[ker.from[i].first] == comps[ker.from[i].second];
+        }
+    }
 
-    auto pair = forbidden[badForbidden.front()];
-    int v1 = pair.first;
-    int v2 = pair.second;
+    if(!conflict) {
+        buf.result = comps;
+        return true;
+    }
 
-    ShortestPath sp(graph, ker);
-    sp.compute(v1);
-    return std::make_pair(false, sp.recoverCounterExample(v2));
-#else
     //Algorithme quadratique mais fournit le contre-exemple minimal
     //À chaque tour de boucle, on prends le sommet qui créé le plus de conflits-non-traités, on calcule
     //les distances à partir de lui et ainsi on prends le "chemin minimal" entre tous
     //les conflits, qui est le contre-exemple minimal
 
-    ShortestPath sp(graph, ker);
-    int bestDist = 1<<30;
-    std::vector<int> bestCounterExample;
-
     //nombre de foit qu'une variable apparait dans un conflit
-    std::vector<int> nbForb(vals.size(), 0);
-    //liste d'adjacence pour les conflits
-    std::vector<std::vector<int>> graphForb(vals.size(), std::vector<int>());
-    for(const auto& pair : forbidden) {
-        int v1 = pair.first;
-        int v2 = pair.second;
-        nbForb[v1] += 1;
-        nbForb[v2] += 1;
-        graphForb[v1].push_back(v2);
-        graphForb[v2].push_back(v1);
+    std::vector<int>& nbForb = buf.nbForb;
+    nbForb.assign(ker.numVar, 0);
+    for(int atom : buf.forbidden) {
+        nbForb[ker.from[atom].first] += 1;
+        nbForb[ker.from[atom].second] += 1;
     }
 
+    //Le choix des sommets ne dépend pas des distances : on calcule d'abord
+    //la suite des sommets de départ et de leurs voisins-conflits, puis les BFS
+    //sont indépendants et peuvent être faits en parallèle
+    buf.tasks.clear();
+    buf.taskNeighs.clear();
     while(true) {
         //indice de la variable qui créé le plus de conflits
-        size_t maxForb = 0;
-        for(size_t i = 1; i < nbForb.size(); ++i) {
+        int maxForb = 0;
+        for(int i = 1; i < ker.numVar; ++i) {
             if(nbForb[i] > nbForb[maxForb]) {
                 maxForb = i;
             }
         }
         if(nbForb[maxForb] == 0) break;
-        nbForb[maxForb] = 0;
 
-        sp.compute(maxForb);
-        int bestNeigh = -1;
-        int dist = 1<<30;
-        for(int neigh : graphForb[maxForb]) {
-            if(nbForb[neigh] != 0) {
+        DecideBuffers::Task task{maxForb, buf.taskNeighs.size(), 0, -1, -1, 1<<30};
+        for(int i = ker.adjStart[maxForb]; i < ker.adjStart[maxForb+1]; ++i) {
+            int neigh = ker.adj[i].first;
+            if(!vals[ker.adj[i].second] && nbForb[neigh] != 0) {
                 nbForb[neigh] -= 1;
-                if(dist > sp.dists[neigh]) {
-                    bestNeigh = neigh;
-                    dist = sp.dists[neigh];
-                }
+                buf.taskNeighs.push_back(ker.adj[i]);
+            }
+        }
+        //mis à zéro après les voisins pour traiter aussi les x<>x
+        nbForb[maxForb] = 0;
+        task.neighEnd = buf.taskNeighs.size();
+        buf.tasks.push_back(task);
+    }
+
+    //Chaque thread du pool a son propre tableau de distances. Sur un petit graphe,
+    //réveiller les threads coûte plus cher que les BFS
+    bool parallel = buf.tasks.size() * ker.numVar >= parallelBfsThreshold;
+    if(parallel && !buf.pool) {
+        buf.pool.reset(new WorkerPool(buf.maxThreads));
+    }
+    size_t nThreads = parallel ? buf.pool->size() : 1;
+    if(buf.dists.size() < nThreads) {
+        buf.dists.resize(nThreads);
+        buf.queues.resize(nThreads);
+    }
+    if(buf.paths.size() < buf.tasks.size()) {
+        buf.paths.resize(buf.tasks.size());
+    }
+    //Chaque tâche donne le contre-exemple de sa disségalité la plus courte
+    auto bfs = [&](size_t worker, size_t i) {
+        DecideBuffers::Task& task = buf.tasks[i];
+        std::vector<int>& dists = buf.dists[worker];
+        shortestPaths(ker, vals, task.start, dists, buf.queues[worker]);
+        for(size_t j = task.neighBegin; j < task.neighEnd; ++j) {
+            int neigh = buf.taskNeighs[j].first;
+            //un voisin non atteignable ne créé pas de conflit
+            if(dists[neigh] != -1 && task.dist > dists[neigh]) {
+                task.bestNeigh = neigh;
+                task.bestAtom = buf.taskNeighs[j].second;
+                task.dist = dists[neigh];
             }
         }
-        if(dist < bestDist) {
-            bestDist = dist;
-            bestCounterExample = sp.recoverCounterExample(bestNeigh);
+        if(task.bestNeigh != -1) {
+            recoverCounterExample(ker, vals, dists, task.start, task.bestNeigh,
+                                  task.bestAtom, buf.paths[i]);
+        }
+    };
+    if(parallel) {
+        buf.pool->run(buf.tasks.size(), bfs);
+    } else {
+        for(size_t i = 0; i < buf.tasks.size(); ++i) {
+            bfs(0, i);
         }
     }
 
-    return std::make_pair(false, bestCounterExample);
-#endif
+    //Les plus courts d'abord, dans l'ordre des tâches à égalité : le premier est
+    //le même que celui de la version séquentielle
+    buf.order.clear();
+    for(size_t i = 0; i < buf.tasks.size(); ++i) {
+        if(buf.tasks[i].bestNeigh != -1) {
+            buf.order.push_back(i);
+        }
+    }
+    std::stable_sort(buf.order.begin(), buf.order.end(), [&](size_t i, size_t j) {
+            return buf.tasks[i].dist < buf.tasks[j].dist;
+        });
+    buf.numLemmas = std::min(std::max<size_t>(maxLemmas, 1), buf.order.size());
+    if(buf.lemmas.size() < buf.numLemmas) {
+        buf.lemmas.resize(buf.numLemmas);
+    }
+    for(size_t k = 0; k < buf.numLemmas; ++k) {
+        std::swap(buf.lemmas[k], buf.paths[buf.order[k]]);
+    }
+    buf.result.clear();
+    if(buf.numLemmas) {
+        buf.result.assign(buf.lemmas[0].begin(), buf.lemmas[0].end());
+    }
+    return false;
 }
 
-std::vector<int> solve(const SmtCnf& sc, bool smtVerbose, bool satVerbose) {
-    auto pair_ = gene(sc);
-    SmtSatKernel ker = pair_.first;
-    SatCnf satc = pair_.second;
-    SatSolver ss(satc._numVar, satVerbose);
-    ss.import(satc);
+std::pair<bool, std::vector<int>> decide(const SmtSatKernel& ker, const std::vector<bool>& vals) {
+    DecideBuffers buf;
+    bool sat = decide(ker, vals, buf);
+    return std::make_pair(sat, std::move(buf.result));
+}
+
+//Boucle SMT : ss résout la partie booléenne, decide vérifie la théorie et
+//donne une clause de conflit à ss tant que le modèle n'est pas cohérent
+//Les clauses de la formule sont déjà dans ss, et decide utilise au plus threads threads
+template<typename Solver>
+static std::vector<int> smtLoop(const SmtSatKernel& ker, Solver& ss, bool smtVerbose,
+                                const std::atomic<bool>* stop, size_t maxLemmas, size_t threads) {
+    ss.setInterrupt(stop);
+    //tableaux et threads réutilisés d'un appel de decide à l'autre
+    DecideBuffers buf;
+    buf.maxThreads = threads;
+    SatCnf::Clause newClause;
     while(true) {
         std::vector<bool> vals = ss.solve();
         if(vals.empty()) {
             return std::vector<int>();
         }
-        auto pair = decide(ker, vals);
-        if(pair.first) {
-            return pair.second;
+        if(decide(ker, vals, buf, maxLemmas)) {
+            return std::move(buf.result);
         }
-        SatCnf::Clause newClause;
+        if(smtVerbose) {
+            std::cout << "Valuation: " << vals << std::endl;
+        }
+        //Toutes les clauses sont ajoutées avant de relancer le solveur SAT
+        for(size_t k = 0; k < buf.numLemmas; ++k) {
+            newClause.literals.clear();
 //Cette condition préprocesseur est là pour tester la performance sans l'algorithme
 //qui trouve un contre-exemple petit
 #if 1
-        for(int i : pair.second) {
+            for(int i : buf.lemmas[k]) {
 #else
-        for(int i = 0; i < vals.size(); ++i) {
+            for(int i = 0; i < vals.size(); ++i) {
 #endif
-            newClause.literals.push_back(SatCnf::Literal{vals[i], i});
+                newClause.literals.push_back(SatCnf::Literal{vals[i], i});
+            }
+            if(smtVerbose) {
+                std::cout << "Counter example: " << buf.lemmas[k] << std::endl;
+                std::cout << "Adding clause " << newClause << std::endl;
+            }
+            ss.addSMTConflict(newClause);
         }
+    }
+}
+
+//Résout une composante connexe, s'arrête dès que stop devient vrai
+//threads est le nombre de threads laissé à cette composante pour les BFS de decide
+//En mode ONLINE, la théorie est vérifiée pendant la recherche et en mode EAGER
+//elle est dans la formule : le modèle rendu est déjà cohérent et la boucle ne
+//fait qu'un tour. Le solveur bit-parallèle ne connait pas la théorie, il n'est
+//donc utilisé qu'en modes LAZY et EAGER
+//Seule la théorie en ligne connait la congruence : elle est toujours utilisée avec
+//des applications de fonctions, et le modèle est alors celui de ses classes
+static std::vector<int> solveComponent(const SmtCnf& sc, bool smtVerbose, bool satVerbose,
+                                       const std::atomic<bool>* stop, const SmtOptions& opts,
+                                       size_t threads) {
+    SmtSatKernel ker = geneKernel(sc);
+    if(ker.from.empty()) {
+        //Pas d'atome : les seules égalités viennent de la congruence
+        return EqTheory(ker, false, sc.apps).classes();
+    }
+    SmtOptions::Mode mode = opts.mode;
+    if(!sc.apps.empty() && mode != SmtOptions::ONLINE) {
+        mode = SmtOptions::ONLINE;
         if(smtVerbose) {
-            std::cout << "Valuation: " << vals << std::endl;
-            std::cout << "Counter example: " << pair.second << std::endl;
-            std::cout << "Adding clause " << newClause << std::endl;
+            std::cout << sc.apps.size() << " function applications: online mode" << std::endl;
+        }
+    }
+    Triangulation tr;
+    if(mode == SmtOptions::AUTO) {
+        double density = graphDensity(ker);
+        mode = SmtOptions::ONLINE;
+        if(density >= opts.eagerDensity) {
+            tr = triangulate(ker);
+            if(ker.from.size() + tr.fill.size() <= opts.eagerMaxAtoms) {
+                mode = SmtOptions::EAGER;
+            }
+        }
+        if(smtVerbose) {
+            std::cout << "Equality graph density " << density << ": "
+                      << (mode == SmtOptions::EAGER ? "eager" : "online") << " mode" << std::endl;
+        }
+    } else if(mode == SmtOptions::EAGER) {
+        tr = triangulate(ker);
+    }
+    //Les clauses de transitivité sont ajoutées après celles de la formule
+    SatCnf trans(0);
+    if(mode == SmtOptions::EAGER) {
+        addTransitivity(ker, trans, tr);
+        if(smtVerbose) {
+            std::cout << "Transitivity: " << tr.fill.size() << " fill atoms, "
+                      << tr.triangles.size() << " triangles" << std::endl;
         }
-        ss.addSMTConflict(newClause);
     }
+    //Les clauses sont écrites directement dans le solveur, sans formule SAT
+    //intermédiaire
+    size_t numAtoms = ker.from.size();
+    auto load = [&](auto& ss) {
+        geneClauses(sc, ker, [&](SatCnf::ClauseRef cl) {
+                ss.addSMTConflict(cl);
+            });
+        if(mode == SmtOptions::EAGER) {
+            ss.import(trans);
+        }
+    };
+    if(mode != SmtOptions::ONLINE && numAtoms <= 64) {
+        SmallSolver<u64> ss(numAtoms, satVerbose);
+        load(ss);
+        return smtLoop(ker, ss, smtVerbose, stop, opts.maxLemmas, threads);
+    } else if(mode != SmtOptions::ONLINE && numAtoms <= 128) {
+        SmallSolver<u128> ss(numAtoms, satVerbose);
+        load(ss);
+        return smtLoop(ker, ss, smtVerbose, stop, opts.maxLemmas, threads);
+    }
+    SatSolver ss(numAtoms, satVerbose);
+    EqTheory theory(ker, smtVerbose, sc.apps);
+    if(mode == SmtOptions::ONLINE) {
+        ss.setTheory(&theory);
+    }
+    load(ss);
+    auto res = smtLoop(ker, ss, smtVerbose, stop, opts.maxLemmas, threads);
+    if(smtVerbose && mode == SmtOptions::ONLINE) {
+        std::cout << "Theory conflicts: " << theory.numConflicts() << std::endl;
+        std::cout << "Theory propagations: " << theory.numPropagations() << std::endl;
+        std::cout << "Fresh atoms: " << theory.numFreshAtoms() << std::endl;
+        if(!sc.apps.empty()) {
+            std::cout << "Congruences: " << theory.numCongruences() << std::endl;
+        }
+    }
+    if(!res.empty() && !sc.apps.empty()) {
+        return theory.classes();
+    }
+    return res;
+}
+
+static std::vector<int> solveFormula(const SmtCnf& sc, bool smtVerbose, bool satVerbose,
+                                     const SmtOptions& opts) {
+    bool empty;
+    auto comps = decompose(sc, empty);
+    //Une clause vide rend la formule insatisfiable
+    if(empty) {
+        return std::vector<int>();
+    }
+    std::vector<std::vector<int>> sols(comps.size());
+    std::atomic<bool> unsat(false);
+
+    //En mode verbeux, on ne peut pas entrelacer les sorties
+    //Les threads qui ne résolvent pas de composante sont partagés entre les BFS
+    //de decide, pour ne pas lancer workerCount() threads dans chaque composante
+    size_t outer = (smtVerbose || satVerbose) ? 1 : std::min(comps.size(), workerCount());
+    size_t inner = std::max<size_t>(1, workerCount() / std::max<size_t>(outer, 1));
+    parallelFor(comps.size(), [&](size_t, size_t i) {
+            if(unsat) return;
+            sols[i] = solveComponent(comps[i].cnf, smtVerbose, satVerbose, &unsat, opts, inner);
+            if(sols[i].empty()) unsat = true;
+        }, outer);
+
+    if(unsat) {
+        return std::vector<int>();
+    }
+
+    //Fusion des modèles : les classes de chaque composante sont décalées pour être
+    //disjointes, et chaque variable libre a sa propre classe
+    std::vector<int> res(sc._numVar, -1);
+    int offset = 0;
+    for(size_t i = 0; i < comps.size(); ++i) {
+        for(size_t j = 0; j < comps[i].vars.size(); ++j) {
+            res[comps[i].vars[j]] = offset + sols[i][j];
+        }
+        offset += comps[i].vars.size();
+    }
+    for(int& c : res) {
+        if(c == -1) {
+            c = offset++;
+        }
+    }
+    return res;
 }
 
+std::vector<int> solve(const SmtCnf& sc, bool smtVerbose, bool satVerbose, const SmtOptions& opts) {
+    if(!opts.preprocess) {
+        return solveFormula(sc, smtVerbose, satVerbose, opts);
+    }
+    SmtPreprocess pre = preprocess(sc);
+    if(smtVerbose) {
+        std::cout << "Preprocessing : " << sc._numVar << " -> " << pre.cnf._numVar << " variables, "
+                  << sc.clauses.size() << " -> " << pre.cnf.clauses.size() << " clauses";
+        if(pre.unsat) {
+            std::cout << ", UNSAT";
+        }
+        std::cout << std::endl;
+    }
+    if(pre.unsat) {
+        return std::vector<int>();
+    }
+    //Une formule vide est satisfaite, mais son modèle vide ne doit pas être lu comme UNSAT
+    std::vector<int> sol;
+    if(pre.cnf._numVar > 0) {
+        sol = solveFormula(pre.cnf, smtVerbose, satVerbose, opts);
+        if(sol.empty()) {
+            return sol;
+        }
+    }
+    return pre.reconstruct(sol);
+}
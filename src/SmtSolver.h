@@ -1,27 +1,123 @@
 #ifndef SMTSOLVER_H
 #define SMTSOLVER_H
 
+#include <algorithm>
+#include <memory>
 #include <utility>
 #include <vector>
-#include <map>
 #include "SatCnf.h"
 #include "SmtCnf.h"
+#include "AtomTable.h"
+#include "Parallel.h"
 
 struct SmtSatKernel {
-    std::map<std::pair<int, int>, int> to;
+    // number of variables of the SMT formula
+    int numVar = 0;
+    // atom of each pair (a, b) with a <= b
+    AtomTable to;
     std::vector<std::pair<int, int>> from;
+    // The atoms of each variable v, as (other variable, atom), are
+    // adj[adjStart[v]] to adj[adjStart[v+1] -1], in the order of the atoms.
+    // An atom x = x is only once in the list of x.
+    std::vector<int> adjStart;
+    std::vector<std::pair<int, int>> adj;
+
+    // build adjStart and adj from from.
+    void buildGraph();
 };
+
+// Atoms of a SMT formula : one for each pair of variables of its literals, numbered
+// in order of first appearance. The graph is built.
+SmtSatKernel geneKernel(const SmtCnf& sc);
+
+// Give the SAT clause of each clause of sc, on the atoms of ker, to out as a
+// SatCnf::ClauseRef that is only valid during the call : a solver can take the
+// clauses without any intermediate formula.
+template<typename Out>
+void geneClauses(const SmtCnf& sc, const SmtSatKernel& ker, Out&& out) {
+    std::vector<SatCnf::Literal> lits;
+    for(const auto& c : sc.clauses) {
+        lits.clear();
+        for(const SmtCnf::Literal& l : c.literals) {
+            int atom = ker.to.find(std::min(l.var1, l.var2), std::max(l.var1, l.var2));
+            lits.push_back(SatCnf::Literal{l.type == SmtCnf::Literal::NOTEQ, atom});
+        }
+        out(SatCnf::ClauseRef(Span<const SatCnf::Literal>(lits.data(), lits.data() + lits.size())));
+    }
+}
+
 // generate a Sat formula and var i of the sat formula is the literal in the vector
 std::pair<SmtSatKernel, SatCnf> gene(const SmtCnf& sc);
 
+// Work arrays of decide(), kept between calls so that checking a model does not allocate.
+struct DecideBuffers {
+    // result of the last call : equivalence classes or counter-example
+    std::vector<int> result;
+
+    std::vector<int> comps;
+    std::vector<int> stack;
+    std::vector<int> forbidden; // false atoms
+    std::vector<int> nbForb;
+    struct Task {
+        int start;
+        size_t neighBegin; // neighbours in taskNeighs, as (variable, atom)
+        size_t neighEnd;
+        int bestNeigh;
+        int bestAtom;
+        int dist;
+    };
+    std::vector<Task> tasks;
+    std::vector<std::pair<int, int>> taskNeighs;
+    std::vector<std::vector<int>> paths; // counter-example of each task
+    std::vector<size_t> order;
+    // The counter-examples of the last call are lemmas[0] to lemmas[numLemmas -1], shortest first.
+    std::vector<std::vector<int>> lemmas;
+    size_t numLemmas = 0;
+    // The BFS run on a pool of at most maxThreads threads (workerCount() if 0), started
+    // by the first call that needs it and kept for the next ones, with one distance
+    // array and BFS queue per worker.
+    size_t maxThreads = 0;
+    std::unique_ptr<WorkerPool> pool;
+    std::vector<std::vector<int>> dists;
+    std::vector<std::vector<int>> queues;
+};
+
 // decide if a list of literal or they opposed version is satisfiable.
-// if it is satisfiable, the bool is true and vector are the equivalence classes
-// if it is not, the bool is false and vector is the index of the literals that form a counter-example
-std::pair<bool, std::vector<int>> decide(const SmtSatKernel& ker, std::vector<bool> vals);
+// if it is satisfiable, returns true and buf.result are the equivalence classes
+// if it is not, returns false and buf.result is the index of the literals that form a counter-example.
+// buf.lemmas also gets up to maxLemmas counter-examples, each on a different false disequality.
+bool decide(const SmtSatKernel& ker, const std::vector<bool>& vals, DecideBuffers& buf,
+            size_t maxLemmas = 1);
+
+// same as above with fresh buffers, the vector is buf.result.
+std::pair<bool, std::vector<int>> decide(const SmtSatKernel& ker, const std::vector<bool>& vals);
+
+struct SmtOptions {
+    // How the equality theory is handled :
+    //  - ONLINE : checked during the SAT search (see EqTheory).
+    //  - LAZY : only checked on complete models of the SAT solver.
+    //  - EAGER : encoded in the SAT formula by transitivity clauses (see Transitivity.h).
+    //  - AUTO : EAGER on small dense equality graphs, ONLINE otherwise, for each component.
+    enum Mode {
+        AUTO, ONLINE, LAZY, EAGER
+    };
+    Mode mode = AUTO;
+    // AUTO uses EAGER if the density of the equality graph is at least eagerDensity
+    // and the eager encoding has at most eagerMaxAtoms atoms (then the bit-parallel
+    // solver is used). On larger graphs, the online theory has always been faster.
+    double eagerDensity = 0.5;
+    size_t eagerMaxAtoms = 128;
+    // In lazy mode, number of conflict clauses added for each inconsistent model.
+    size_t maxLemmas = 8;
+    // Simplify the formula before its encoding (see SmtPreprocess.h).
+    bool preprocess = true;
+};
 
 // solve a SMT CNF
+// The independent components of the formula are solved separately (in parallel if possible).
 // empty vector if not satisfiable
-std::vector<int> solve(const SmtCnf& sc, bool smtVerbose=false, bool satVerbose=false);
+std::vector<int> solve(const SmtCnf& sc, bool smtVerbose=false, bool satVerbose=false,
+                       const SmtOptions& opts = SmtOptions());
 
 
 #endif
@@ -0,0 +1,103 @@
+#include "Transitivity.h"
+#include <queue>
+#include <set>
+
+using namespace std;
+
+// Number of missing edges between the neighbours of v.
+static size_t fillCount(const vector<set<int>>& adj, int v){
+    size_t res = 0;
+    for(auto it = adj[v].begin() ; it != adj[v].end() ; ++it){
+        for(auto jt = next(it) ; jt != adj[v].end() ; ++jt){
+            if(!adj[*it].count(*jt)) ++res;
+        }
+    }
+    return res;
+}
+
+Triangulation triangulate(const SmtSatKernel& ker){
+    Triangulation res;
+    vector<set<int>> adj(ker.numVar);
+    for(auto& p : ker.from){
+        if(p.first == p.second) continue;
+        adj[p.first].insert(p.second);
+        adj[p.second].insert(p.first);
+    }
+
+    // heap of (fill, vertex) : the fill of a vertex only changes when a neighbour
+    // is eliminated, then it is pushed again and the old entry is skipped.
+    // The new edges can also change the fill of vertices that are not neighbours,
+    // this is ignored : it is a heuristic.
+    vector<size_t> fill(ker.numVar);
+    vector<bool> eliminated(ker.numVar, false);
+    using Entry = pair<size_t, int>;
+    priority_queue<Entry, vector<Entry>, greater<Entry>> heap;
+    for(int v = 0 ; v < ker.numVar ; ++v){
+        fill[v] = fillCount(adj, v);
+        heap.push(Entry(fill[v], v));
+    }
+
+    while(!heap.empty()){
+        Entry e = heap.top();
+        heap.pop();
+        int v = e.second;
+        if(eliminated[v] or e.first != fill[v]) continue;
+        eliminated[v] = true;
+        vector<int> neighs(adj[v].begin(), adj[v].end());
+        for(size_t i = 0 ; i < neighs.size() ; ++i){
+            for(size_t j = i+1 ; j < neighs.size() ; ++j){
+                int u = neighs[i], w = neighs[j]; // u < w
+                res.triangles.push_back({{v, u, w}});
+                if(adj[u].insert(w).second){
+                    adj[w].insert(u);
+                    res.fill.push_back(make_pair(u, w));
+                }
+            }
+        }
+        for(int u : neighs){
+            adj[u].erase(v);
+        }
+        adj[v].clear();
+        for(int u : neighs){
+            fill[u] = fillCount(adj, u);
+            heap.push(Entry(fill[u], u));
+        }
+    }
+    return res;
+}
+
+double graphDensity(const SmtSatKernel& ker){
+    vector<bool> used(ker.numVar, false);
+    size_t edges = 0;
+    for(auto& p : ker.from){
+        used[p.first] = used[p.second] = true;
+        if(p.first != p.second) ++edges;
+    }
+    size_t n = 0;
+    for(bool b : used) n += b;
+    if(n < 2) return 1;
+    return 2.0 * edges / (double(n) * (n-1));
+}
+
+void addTransitivity(SmtSatKernel& ker, SatCnf& cnf, const Triangulation& tr){
+    for(auto& p : tr.fill){
+        int atom = ker.to.insert(p.first, p.second, ker.from.size());
+        if(atom == (int)ker.from.size()) ker.from.push_back(p);
+    }
+    auto atomOf = [&](int a, int b){
+        if(b < a) swap(a, b);
+        return ker.to.find(a, b);
+    };
+    for(auto& t : tr.triangles){
+        int e[3] = {atomOf(t[1], t[2]), atomOf(t[0], t[2]), atomOf(t[0], t[1])};
+        // two equalities of the triangle imply the third one.
+        for(int i = 0 ; i < 3 ; ++i){
+            for(int j = 0 ; j < 3 ; ++j){
+                cnf.clauses.pushLiteral(SatCnf::Literal{i != j, e[j]});
+            }
+            cnf.clauses.closeClause();
+        }
+    }
+    cnf._numVar = ker.from.size();
+    ker.buildGraph();
+}
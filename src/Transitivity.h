@@ -0,0 +1,34 @@
+#ifndef TRANSITIVITY_H
+#define TRANSITIVITY_H
+
+#include <array>
+#include <utility>
+#include <vector>
+#include "SatCnf.h"
+#include "SmtSolver.h"
+
+/**
+   @brief Chordal completion of the equality graph of a SmtSatKernel.
+
+   The graph has an edge for each atom a = b (a != b). Vertices are eliminated
+   one by one, taking the one whose elimination adds the fewest edges between
+   its remaining neighbours (minimum fill). The added edges make the graph
+   chordal, and the triangles of a chordal graph are exactly the triples
+   (v, u, w) where u and w are neighbours of v eliminated after v.
+ */
+struct Triangulation{
+    std::vector<std::pair<int, int>> fill; // added edges, (a, b) with a < b
+    std::vector<std::array<int, 3>> triangles; // as triples of vertices
+};
+
+Triangulation triangulate(const SmtSatKernel& ker);
+
+// Density of the equality graph : edges / possible edges between the vertices that have an atom.
+double graphDensity(const SmtSatKernel& ker);
+
+// Eager encoding of the equality theory (Bryant and Velev sparse transitivity) :
+// add an atom to ker for each fill edge, and the 3 transitivity clauses of each
+// triangle to cnf. Every model of cnf is then consistent with the theory.
+void addTransitivity(SmtSatKernel& ker, SatCnf& cnf, const Triangulation& tr);
+
+#endif
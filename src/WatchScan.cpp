@@ -0,0 +1,62 @@
+#include "WatchScan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WATCHSCAN_X86
+#endif
+
+static size_t scanScalar(const int* lits, size_t i, size_t n, const u8* falseOf){
+    for(; i < n ; ++i){
+        if(!falseOf[lits[i]]) break;
+    }
+    return i;
+}
+
+#ifdef WATCHSCAN_X86
+
+// The falseOf bytes of lits[0..8) in 8 lanes of 32 bits.
+__attribute__((target("avx2")))
+static inline __m256i gather8(const int* lits, const u8* falseOf){
+    __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lits));
+    __m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(falseOf), idx, 1);
+    return _mm256_and_si256(words, _mm256_set1_epi32(0xFF));
+}
+
+// 8 literals per gather, 32 literals per step.
+__attribute__((target("avx2")))
+static size_t scanAvx2(const int* lits, size_t i, size_t n, const u8* falseOf){
+    const __m256i zero = _mm256_setzero_si256();
+    // packs work per 128 bits lane : this puts the 32 bytes back in order.
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    for(; i + 32 <= n ; i += 32){
+        __m256i p01 = _mm256_packs_epi32(gather8(lits + i, falseOf), gather8(lits + i + 8, falseOf));
+        __m256i p23 = _mm256_packs_epi32(gather8(lits + i + 16, falseOf), gather8(lits + i + 24, falseOf));
+        __m256i f = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(p01, p23), order);
+        unsigned m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(f, zero));
+        if(m) return i + __builtin_ctz(m);
+    }
+    for(; i + 8 <= n ; i += 8){
+        __m256i f = gather8(lits + i, falseOf);
+        unsigned m = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(f, zero)));
+        if(m) return i + __builtin_ctz(m);
+    }
+    return scanScalar(lits, i, n, falseOf);
+}
+
+#endif
+
+static WatchScanFn selectKernel(const char** name){
+#ifdef WATCHSCAN_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        *name = "avx2";
+        return scanAvx2;
+    }
+#endif
+    *name = "scalar";
+    return scanScalar;
+}
+
+static const char* selectedName = nullptr;
+const WatchScanFn watchScanKernel = selectKernel(&selectedName);
+const char* const watchScanName = selectedName;
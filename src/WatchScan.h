@@ -0,0 +1,36 @@
+#ifndef WATCHSCAN_H
+#define WATCHSCAN_H
+
+#include <cstddef>
+#include "Bitset.h"
+
+/**
+   @brief Search of a replacement watched literal in a clause.
+
+   lits are literals encoded as 2*var + neg and falseOf is a byte per literal :
+   non-zero if the literal is false in the model. falseOf must be readable 3 bytes
+   past the last literal, because the AVX2 kernel reads it 4 bytes at a time.
+
+   The kernels return the index of the first literal of lits[from..n) which is not
+   false, or n if they are all false.
+ */
+using WatchScanFn = size_t (*)(const int* lits, size_t from, size_t n, const u8* falseOf);
+
+// Kernel selected at startup from the cpu features (AVX2 or scalar).
+extern const WatchScanFn watchScanKernel;
+// Name of the selected kernel.
+extern const char* const watchScanName;
+
+// Under this number of literals, the scalar loop is faster than the kernels (at 16
+// literals with 90% false, AVX2 takes 22 ns and the scalar loop 18 ns).
+const size_t watchScanMinLength = 32;
+
+inline size_t firstNonFalse(const int* lits, size_t from, size_t n, const u8* falseOf){
+    if(n - from >= watchScanMinLength) return watchScanKernel(lits, from, n, falseOf);
+    for(; from < n ; ++from){
+        if(!falseOf[lits[from]]) break;
+    }
+    return from;
+}
+
+#endif
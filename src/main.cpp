@@ -3,9 +3,19 @@
 #include "SatCnf.h"
 #include "SatSolver.h"
 #include "SmtSolver.h"
+#include "Decompose.h"
+#include "LocalSearch.h"
+#include "WatchScan.h"
+#include "InputBuffer.h"
+#include "CnfCache.h"
+#include "SmtLib.h"
+#include "ClauseQueue.h"
 #include <fstream>
+#include <chrono>
+#include <sstream>
 #include <cerrno>
 #include <cstring>
+#include <thread>
 #include "prettyprint.hpp"
 
 
@@ -14,6 +24,9 @@ using namespace std;
 int main(int argc, char**argv){
     bool satverbose = false;
     bool smtverbose = false;
+    bool hybrid = false;
+    vector<SatCnf::Literal> assumptions;
+    SmtOptions smtOpts;
     try{
         for(int cur  = 1 ; cur < argc ; ++cur){
             string s = argv[cur];
@@ -26,8 +39,146 @@ int main(int argc, char**argv){
                 satverbose = true;
                 smtverbose = true;
                 cout << "VeryVerbose mode activated" << endl;
+                cout << "Watch scan kernel : " << watchScanName << endl;
                 continue;
             }
+            else if(s == "-hybrid"){
+                hybrid = true;
+                cout << "Local search hybrid activated" << endl;
+                continue;
+            }
+            else if(s == "-lazy"){
+                smtOpts.mode = SmtOptions::LAZY;
+                cout << "Lazy theory check activated" << endl;
+                continue;
+            }
+            else if(s == "-online"){
+                smtOpts.mode = SmtOptions::ONLINE;
+                cout << "Online theory check activated" << endl;
+                continue;
+            }
+            else if(s == "-auto"){
+                smtOpts.mode = SmtOptions::AUTO;
+                continue;
+            }
+            else if(s == "-eager"){
+                smtOpts.mode = SmtOptions::EAGER;
+                cout << "Eager transitivity encoding activated" << endl;
+                continue;
+            }
+            else if(s == "-nopre"){
+                smtOpts.preprocess = false;
+                cout << "SMT preprocessing deactivated" << endl;
+                continue;
+            }
+            else if(s == "-lemmas"){
+                ++cur;
+                if(cur >= argc){
+                    cerr << "Not enough argument" <<endl;
+                    return 1;
+                }
+                smtOpts.maxLemmas = stoul(argv[cur]);
+                cout << "At most " << smtOpts.maxLemmas << " lemmas per theory check" << endl;
+                continue;
+            }
+            else if(s == "-assume"){
+                ++cur;
+                if(cur >= argc){
+                    cerr << "Not enough argument" <<endl;
+                    return 1;
+                }
+                // DIMACS literals, as "1 -3".
+                istringstream lits(argv[cur]);
+                int lit;
+                while(lits >> lit){
+                    if(lit == 0) continue;
+                    assumptions.push_back(SatCnf::Literal{lit < 0, abs(lit) -1});
+                }
+                cout << "Assumptions : " << assumptions << endl;
+                continue;
+            }
+            else if(s == "-parsebench"){
+                // throughput of the stream parser and of the block parser on the same file.
+                if(cur + 2 >= argc){
+                    cerr << "Not enough argument" <<endl;
+                    return 1;
+                }
+                string format = argv[cur+1];
+                string filename = argv[cur+2];
+                cur += 2;
+                auto mbps = [](size_t bytes, chrono::steady_clock::time_point start){
+                    double t = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                    return bytes / t / 1e6;
+                };
+                auto start = chrono::steady_clock::now();
+                ifstream file(filename);
+                file.exceptions(istream::failbit);
+                size_t streamClauses = format == "smt" ? SmtCnf(file).clauses.size() : SatCnf(file).clauses.size();
+                file.exceptions(istream::goodbit);
+                file.clear();
+                file.seekg(0, ios::end);
+                size_t bytes = file.tellg();
+                double streamRate = mbps(bytes, start);
+                start = chrono::steady_clock::now();
+                InputBuffer in(filename);
+                size_t blockClauses = format == "smt" ? SmtCnf(in).clauses.size() : SatCnf(in).clauses.size();
+                double blockRate = mbps(bytes, start);
+                cout << "Stream parser : " << streamClauses << " clauses, " << streamRate << " MB/s" << endl;
+                cout << "Block parser : " << blockClauses << " clauses, " << blockRate << " MB/s" << endl;
+                continue;
+            }
+            else if(s == "-convert"){
+                if(cur + 3 >= argc){
+                    cerr << "Not enough argument" <<endl;
+                    return 1;
+                }
+                string format = argv[cur+1];
+                string filename = argv[cur+2];
+                string output = argv[cur+3];
+                cur += 3;
+                InputBuffer in(filename);
+                ofstream out(output, ios::binary);
+                if(!out) throw ios_base::failure("Can't open " + output);
+                size_t numClauses;
+                if(format == "smt"){
+                    SmtCnf sc(in);
+                    writeCache(sc, out);
+                    numClauses = sc.clauses.size();
+                }
+                else{
+                    SatCnf sc(in);
+                    writeCache(sc, out);
+                    numClauses = sc.clauses.size();
+                }
+                out.close();
+                if(!out) throw ios_base::failure("Can't write " + output);
+                cout << "Cache of " << numClauses << " clauses written to " << output << endl;
+                continue;
+            }
+            else if(s == "-ls"){
+                ++cur;
+                if(cur >= argc){
+                    cerr << "Not enough argument" <<endl;
+                    return 1;
+                }
+                string filename = argv[cur];
+                if(s != "-") cout << "Opening " << filename << " : " << endl;
+                InputBuffer in(filename);
+                SatCnf sc(in);
+                cout << "Local search :" << endl;
+                cout << sc << endl;
+                LocalSearch ls(sc);
+                vector<bool> sol(sc._numVar, true);
+                bool found = ls.run(sol, 1000000000ull);
+                cout << ls.flips() << " flips, " << ls.flipsPerSecond() << " flips/s" << endl;
+                if(!found){
+                    cout << "No solution found" << endl;
+                    return 1;
+                }
+                cout << "Solution : " << sol << endl;
+                cout << sc.eval(sol) << endl;
+                return 0;
+            }
             else if(s == "-sat"){
                 ++cur;
                 if(cur >= argc){
@@ -35,16 +186,23 @@ int main(int argc, char**argv){
                     return 1;
                 }
                 string filename = argv[cur];
-                ifstream file(filename);
-                istream& in = (filename == "-" ? cin : file);
                 if(s != "-") cout << "Opening " << filename << " : " << endl;
-                in.exceptions(istream::failbit); // immediate launch if file can't be opened
+                InputBuffer in(filename);
                 SatCnf sc(in);
                 cout << "Solving :" << endl;
                 cout << sc << endl;
-                SatSolver sats(sc._numVar,satverbose);
-                sats.import(sc);
-                auto sol = sats.solve();
+                vector<bool> sol;
+                if(assumptions.empty()){
+                    sol = solveSat(sc, satverbose, hybrid);
+                }
+                else{
+                    // the assumptions need one solver for the whole formula.
+                    SatSolver ss(sc._numVar, satverbose);
+                    ss.setLocalSearch(hybrid);
+                    ss.import(sc);
+                    sol = ss.solve(assumptions);
+                    if(sol.empty()) cout << "Failed assumptions : " << ss.failed() << endl;
+                }
                 cout << "Solution : " << sol << endl;
 
                 if(!sol.empty()){
@@ -52,6 +210,47 @@ int main(int argc, char**argv){
                 }
                 return 0;
             }
+            else if(s == "-stream"){
+                ++cur;
+                if(cur >= argc){
+                    cerr << "Not enough argument" <<endl;
+                    return 1;
+                }
+                string filename = argv[cur];
+                if(s != "-") cout << "Streaming " << filename << " : " << endl;
+                // a producer thread reads the clauses while the solver searches.
+                InputBuffer in(filename);
+                ClauseQueue queue;
+                SatSolver ss(0, satverbose);
+                ss.setLocalSearch(hybrid);
+                ss.setQueue(&queue);
+                atomic<bool> stop(false);
+                size_t numVar = 0, numClauses = 0;
+                exception_ptr error;
+                thread producer([&]{
+                    try{
+                        numClauses = SatCnf::stream(in, [&](size_t n){ numVar = n; },
+                                                    [&](SatCnf::ClauseRef cl){
+                                                        queue.push(cl);
+                                                        return !stop;
+                                                    });
+                    }
+                    catch(...){
+                        error = current_exception();
+                    }
+                    queue.close();
+                });
+                vector<bool> sol = ss.solve();
+                // an UNSAT answer doesn't need the rest of the input.
+                stop = true;
+                producer.join();
+                if(error) rethrow_exception(error);
+                // the variables of no clause are free.
+                if(!sol.empty()) sol.resize(numVar, true);
+                cout << numClauses << " clauses read" << endl;
+                cout << "Solution : " << sol << endl;
+                return 0;
+            }
             else if(s == "-smt"){
                 ++cur;
                 if(cur >= argc){
@@ -59,14 +258,12 @@ int main(int argc, char**argv){
                     return 1;
                 }
                 string filename = argv[cur];
-                ifstream file(filename);
-                istream& in = (filename == "-" ? cin : file);
                 if(s != "-") cout << "Opening " << filename << " : " << endl;
-                in.exceptions(istream::failbit); // immediate launch if file can't be opened
+                InputBuffer in(filename);
                 SmtCnf sc(in);
                 cout << "Solving" << endl;
                 cout << sc;
-                auto sol = solve(sc, smtverbose, satverbose);
+                auto sol = solve(sc, smtverbose, satverbose, smtOpts);
                 cout << "Solution : " << sol << endl;
                 if(!sol.empty()) {
                     cout << sc.eval(sol) << endl;
@@ -74,6 +271,18 @@ int main(int argc, char**argv){
 
                 exit(0);
             }
+            else if(s == "-smt2"){
+                ++cur;
+                if(cur >= argc){
+                    cerr << "Not enough argument" <<endl;
+                    return 1;
+                }
+                // the answers of the script are the only output.
+                InputBuffer in(argv[cur]);
+                SmtLib script(cout, smtverbose, satverbose);
+                script.run(in);
+                return 0;
+            }
             /*else if(s == "-gsat"){
                 
               }*/
@@ -0,0 +1,23 @@
+#!/bin/bash
+# Compare the ways of handling the equality theory on the SMT tests.
+# usage : tests/bench_modes.sh [runs] (from the root of the repository, after make)
+runs=${1:-5}
+modes="-online -eager -lazy -auto"
+
+printf "%-12s" "test"
+for m in $modes; do printf "%10s" "$m"; done
+echo
+for f in tests/smt_* tests/euf_*; do
+    printf "%-12s" "$(basename "$f")"
+    for m in $modes; do
+        opt=$m
+        [ "$m" = "-auto" ] && opt=""
+        start=$(date +%s%N)
+        for i in $(seq "$runs"); do
+            ./SMT $opt -smt "$f" > /dev/null
+        done
+        end=$(date +%s%N)
+        printf "%9.1fms" "$(echo "$start $end $runs" | awk '{print ($2-$1)/$3/1e6}')"
+    done
+    echo
+done
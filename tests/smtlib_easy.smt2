@@ -0,0 +1,31 @@
+; Small SMT-LIB2 script for ./SMT -smt2.
+; Expected output: sat unsat sat unsat sat
+(set-logic QF_UF)
+(declare-sort U 0)
+(declare-fun f (U) U)
+(declare-fun g (U U) U)
+(declare-const a U)
+(declare-const b U)
+(declare-const c U)
+(declare-fun p () Bool)
+(assert (distinct a b c))
+(assert (or (= (f a) b) (= (f a) c)))
+(check-sat)
+(push 1)
+(assert (= (f a) (f b)))
+(assert (let ((x (f a))) (= (g x x) a)))
+(assert (= (g b b) (ite p a b)))
+(assert (= (g c c) b))
+(assert (= (f b) c))
+(check-sat)
+(pop 1)
+(push 1)
+(assert (let ((x (f a)) (y (f b))) (and (= x y) (distinct y c))))
+(check-sat)
+(assert (= (f (f a)) a))
+(assert (= (f b) a))
+(check-sat)
+(pop 1)
+(assert (ite p (= (f a) b) (= (f a) c)))
+(check-sat)
+(exit)